@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <limits>
+#include <mutex>
 
 #include "VRI/VRIResources.h"
 
@@ -51,6 +52,10 @@ public:
 		return get()->mDescriptorSet;
 	}
 
+	// Held while handing out bindless addresses or writing to the bindless set
+	// Images are created on loading threads while the render thread updates its own descriptors
+	EXPORT static std::mutex& getMutex();
+
 private:
 
 	TUnique<CDescriptorPool> mDescriptorPool = nullptr;
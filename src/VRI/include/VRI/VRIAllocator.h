@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <mutex>
+
 #include "VRISwapchain.h"
 #include "sstl/Array.h"
 #include "sstl/Memory.h"
@@ -19,18 +21,20 @@ public:
     EXPORT void destroy2();
 
     void pushResource(const TFrail<SVRIResource>& inResource) {
+        std::lock_guard lock(m_Mutex);
         m_Resources.push(inResource);
     }
 
     template <typename TResource, typename... TArgs>
     TShared<TResource> allocateResource(TArgs&&... args) {
         auto ptr = TShared<TResource>{std::forward<TArgs>(args)...};
-        m_Resources.push(ptr.template staticCast<SVRIResource>());
+        pushResource(ptr.template staticCast<SVRIResource>());
         return ptr;
     }
 
     // Tells the resource to destroy itself, removes from tracking
     void releaseResource(const TFrail<SVRIResource>& inResource) {
+        std::lock_guard lock(m_Mutex);
         if (m_Destroyed) return; // The allocator, upon destruction, automatically destroys all assets
         if (m_Resources.contains(inResource.get())) {
             const auto index = m_Resources.find(inResource.get());
@@ -40,22 +44,36 @@ public:
     }
 
     void immediateRelease(const TFrail<SVRIResource>& inResource) {
-        if (m_Destroyed) return; // The allocator, upon destruction, automatically destroys all assets
-        if (m_Resources.contains(inResource.get())) {
+        {
+            std::lock_guard lock(m_Mutex);
+            if (m_Destroyed) return; // The allocator, upon destruction, automatically destroys all assets
+            if (!m_Resources.contains(inResource.get())) return;
             m_Resources.pop(inResource);
-            inResource->getDestroyer()();
         }
+        inResource->getDestroyer()();
     }
 
     void popDeferredQueue(const size_t inFrameIndex) {
-        m_DeletionQueue.get(inFrameIndex).forEach([](size_t, const std::function<void()>& inDestroyer) {
-            inDestroyer();
-        });
-        m_DeletionQueue.get(inFrameIndex).clear();
+        // Destroyers run outside of the lock, so loading threads can keep creating resources meanwhile
+        std::vector<std::function<void()>> destroyers;
+        {
+            std::lock_guard lock(m_Mutex);
+            m_DeletionQueue.get(inFrameIndex).forEach([&](size_t, const std::function<void()>& inDestroyer) {
+                destroyers.push_back(inDestroyer);
+            });
+            m_DeletionQueue.get(inFrameIndex).clear();
+        }
+        for (const auto& destroyer : destroyers) {
+            destroyer();
+        }
     }
 
 private:
 
+    // Resources are created and released from loading threads as well as the render thread
+    // Leaf lock, destroyers only ever run after it is released
+    std::mutex m_Mutex;
+
     bool m_Destroyed = false;
 
     VmaAllocator_T* m_Allocator = nullptr;
@@ -89,8 +89,9 @@ public:
 
     EXPORT CVRISwapchain(struct SDL_Window* window);
 
-    EXPORT void create(VkSwapchainKHR oldSwapchain, bool inUseVSync = true);
-    EXPORT void recreate(bool inUseVSync = true);
+    // The extent is passed in rather than asked of the window, since this can run on the render thread
+    EXPORT void create(VkSwapchainKHR oldSwapchain, Extent32u inExtent, bool inUseVSync = true);
+    EXPORT void recreate(Extent32u inExtent, bool inUseVSync = true);
 
     EXPORT virtual void destroy2();
 
@@ -7,6 +7,11 @@ TUnique<CBindlessResources>& CBindlessResources::get() {
 	return bindlessResources;
 }
 
+std::mutex& CBindlessResources::getMutex() {
+	static std::mutex bindlessMutex;
+	return bindlessMutex;
+}
+
 //TODO: permanent move for these
 struct SPushConstants : std::array<Vector4f, 8> {
 	SPushConstants() : array() {
@@ -13,7 +13,10 @@ CVRIAllocator::CVRIAllocator() {
 
 void CVRIAllocator::destroy2() {
 
-    m_Destroyed = true;
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Destroyed = true;
+    }
 
     for (size_t overlap = 0; overlap < CVRI::get()->getSwapchain()->m_Buffering.getFrameOverlap(); ++overlap) {
         popDeferredQueue(overlap);
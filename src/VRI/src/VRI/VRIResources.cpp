@@ -501,8 +501,11 @@ void SVRIBuffer::makeGlobal() {
 	// Update descriptors with new buffer
 	//TODO: need some way of guaranteeing Buffer addresses so they don't have to be passed in push constants
 	static uint32 gCurrentBufferAddress = 0;
-	mBindlessAddress = gCurrentBufferAddress;
-	gCurrentBufferAddress++;
+	{
+		std::lock_guard lock(CBindlessResources::getMutex());
+		mBindlessAddress = gCurrentBufferAddress;
+		gCurrentBufferAddress++;
+	}
 
 	updateGlobal();
 
@@ -525,6 +528,7 @@ void SVRIBuffer::updateGlobal() const {
 		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
 		.pBufferInfo = &bufferDescriptorInfo,
 	};
+	std::lock_guard lock(CBindlessResources::getMutex());
 	vkUpdateDescriptorSets(CVRI::get()->getDevice()->device, 1, &writeSet, 0, nullptr);
 }
 
@@ -607,6 +611,9 @@ SVRIImage::SVRIImage(const std::string& inDebugName, const VkExtent3D inExtent,
 
 	// Update descriptors with new image
 	if ((inFlags & VK_IMAGE_USAGE_SAMPLED_BIT) != 0) { //TODO: VK_IMAGE_USAGE_SAMPLED_BIT is not a permanent solution
+		// Images are created on loading threads too, so the address and the write happen under the bindless lock
+		std::lock_guard lock(CBindlessResources::getMutex());
+
 		// Set and increment current texture address
 		static uint32 gCurrentTextureAddress = 0;
 		mBindlessAddress = gCurrentTextureAddress;
@@ -88,23 +88,22 @@ CVRISwapchain::CVRISwapchain(SDL_Window* window): m_Window(window) {
 		//mRenderSemaphore = TUnique<CSemaphore>{semaphoreCreateInfo};
 	});
 
-	create(VK_NULL_HANDLE);
+	int width, height;
+	SDL_GetWindowSize(m_Window, &width, &height);
+
+	create(VK_NULL_HANDLE, {static_cast<uint32>(width), static_cast<uint32>(height)});
 }
 
-void CVRISwapchain::create(const VkSwapchainKHR oldSwapchain, const bool inUseVSync) {
+void CVRISwapchain::create(const VkSwapchainKHR oldSwapchain, const Extent32u inExtent, const bool inUseVSync) {
 	mFormat = VK_FORMAT_R8G8B8A8_UNORM;
 
 	m_VSync = inUseVSync;
 
-
-	int width, height;
-	SDL_GetWindowSize(m_Window, &width, &height);
-
 	const auto& vkbSwapchain = vkb::SwapchainBuilder{*CVRI::get()->getDevice()} //TODO: remove usage of device
 		.set_old_swapchain(oldSwapchain)
 		.set_desired_format(VkSurfaceFormatKHR{ .format = mFormat, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR })
 		.set_desired_present_mode(m_VSync ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR)
-		.set_desired_extent(width, height)
+		.set_desired_extent(inExtent.x, inExtent.y)
 		.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
 		.build();
 
@@ -122,8 +121,8 @@ void CVRISwapchain::create(const VkSwapchainKHR oldSwapchain, const bool inUseVS
 	mSwapchain->init(vkbSwapchain);
 }
 
-void CVRISwapchain::recreate(const bool inUseVSync) {
-	create(*mSwapchain->mInternalSwapchain, inUseVSync);
+void CVRISwapchain::recreate(const Extent32u inExtent, const bool inUseVSync) {
+	create(*mSwapchain->mInternalSwapchain, inExtent, inUseVSync);
 	clean();
 }
 
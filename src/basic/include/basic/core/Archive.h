@@ -9,6 +9,8 @@
 #include <string>
 #include <memory>
 #include <stack>
+#include <array>
+#include <type_traits>
 
 #include "Class.h"
 #include "Object.h"
@@ -18,6 +20,42 @@
 
 class CArchive;
 
+// Types whose serialized form is exactly their memory, so a contiguous run of them can be written or read in one go
+// Structs can opt in with 'constexpr static bool mBitwiseSerializable = true;' if they have no padding and serialize every member in order
+template <typename TType>
+struct TBitwiseSerializable : std::bool_constant<std::is_arithmetic_v<TType> || std::is_enum_v<TType>> {};
+
+template <typename TType>
+requires requires { TType::mBitwiseSerializable; }
+struct TBitwiseSerializable<TType> : std::bool_constant<TType::mBitwiseSerializable> {};
+
+template <glm::length_t TSize, typename TType>
+struct TBitwiseSerializable<glm::vec<TSize, TType>> : std::bool_constant<TBitwiseSerializable<TType>::value && sizeof(glm::vec<TSize, TType>) == TSize * sizeof(TType)> {};
+
+template <glm::length_t TCSize, glm::length_t TRSize, typename TType>
+struct TBitwiseSerializable<glm::mat<TCSize, TRSize, TType>> : std::bool_constant<TBitwiseSerializable<TType>::value && sizeof(glm::mat<TCSize, TRSize, TType>) == TCSize * TRSize * sizeof(TType)> {};
+
+template <typename TType, size_t TSize>
+struct TBitwiseSerializable<std::array<TType, TSize>> : std::bool_constant<TBitwiseSerializable<TType>::value && sizeof(std::array<TType, TSize>) == TSize * sizeof(TType)> {};
+
+// The classes used in one file, so objects can store a small index instead of their class name
+// Written once per file as each class's id and name
+struct SClassTable {
+
+	// Index of the class, adding it if it is new
+	uint32 add(SClass* inClass) {
+		const auto [itr, inserted] = mIndices.emplace(inClass, static_cast<uint32>(mClasses.size()));
+		if (inserted) mClasses.push_back(inClass);
+		return itr->second;
+	}
+
+	no_discard bool empty() const { return mClasses.empty(); }
+
+	std::vector<SClass*> mClasses;
+
+	std::unordered_map<const SClass*, uint32> mIndices;
+};
+
 // A serializable function that can be passed down
 class ISerializable {
 public:
@@ -31,6 +69,85 @@ class CArchive {
 public:
 	virtual ~CArchive() = default;
 
+	//
+	// Bulk
+	// A contiguous run of bitwise serializable values is a single write or read, instead of one virtual call per value
+	// Produces the exact same bytes as serializing each value one by one
+	//
+
+	template <typename TType>
+	requires TBitwiseSerializable<TType>::value
+	void writeSpan(const TType* inValues, const size_t inCount) {
+		if (inCount > 0) write(inValues, sizeof(TType), inCount);
+	}
+
+	template <typename TType>
+	requires TBitwiseSerializable<TType>::value and (not std::is_const_v<TType>)
+	void readSpan(TType* outValues, const size_t inCount) {
+		if (inCount > 0) read(outValues, sizeof(TType), inCount);
+	}
+
+	//
+	// Varints
+	// Seven bits per byte, with the high bit set while more bytes follow, so small values take a single byte
+	//
+
+	void writeVarint(uint64 inValue) {
+		uint8 bytes[10];
+		size_t count = 0;
+		do {
+			bytes[count] = inValue & 0x7f;
+			inValue >>= 7;
+			if (inValue) bytes[count] |= 0x80;
+			count++;
+		} while (inValue);
+		write(bytes, 1, count);
+	}
+
+	uint64 readVarint() {
+		uint64 value = 0;
+		uint8 byte;
+		for (uint32 shift = 0; shift < 64; shift += 7) {
+			read(&byte, 1, 1);
+			value |= static_cast<uint64>(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) break;
+		}
+		return value;
+	}
+
+	//
+	// Classes
+	// Polymorphic objects store their class before themselves
+	// With a class table that is a varint index into it, otherwise it is the class's name
+	//
+
+	void setClassTable(SClassTable* inTable) { m_ClassTable = inTable; }
+
+	no_discard SClassTable* getClassTable() const { return m_ClassTable; }
+
+	void writeClass(SClass* inClass) {
+		if (m_ClassTable) {
+			writeVarint(m_ClassTable->add(inClass));
+		} else {
+			*this << inClass->getName();
+		}
+	}
+
+	SClass* readClass() {
+		if (m_ClassTable) {
+			const uint64 index = readVarint();
+			asts(index < m_ClassTable->mClasses.size(), "Class index {} is outside of a class table of {}.", index, m_ClassTable->mClasses.size());
+			SClass* cls = m_ClassTable->mClasses[index];
+			asts(cls, "Class index {} refers to a class that no longer exists.", index);
+			return cls;
+		}
+
+		std::string className;
+		*this >> className;
+		asts(SClassRegistry::get()->getObjects().contains(className), "Class {} does not exist.", className);
+		return SClassRegistry::get()->getObjects().get(className).get();
+	}
+
 	//
 	// Strings
 	// Since strings need to know how much to read from, they encode their size right before the actual string
@@ -57,25 +174,38 @@ public:
 
 	template <glm::length_t TSize, typename TType>
 	friend CArchive& operator<<(CArchive& inArchive, const glm::vec<TSize, TType>& inVector) {
-		for (glm::length_t i = 0; i < TSize; ++i) {
-			inArchive << inVector[i];
+		if constexpr (TBitwiseSerializable<glm::vec<TSize, TType>>::value) {
+			inArchive.writeSpan(&inVector[0], TSize);
+		} else {
+			for (glm::length_t i = 0; i < TSize; ++i) {
+				inArchive << inVector[i];
+			}
 		}
 		return inArchive;
 	}
 
 	template <glm::length_t TSize, typename TType>
 	friend CArchive& operator>>(CArchive& inArchive, glm::vec<TSize, TType>& inVector) {
-		for (glm::length_t i = 0; i < TSize; ++i) {
-			inArchive >> inVector[i];
+		if constexpr (TBitwiseSerializable<glm::vec<TSize, TType>>::value) {
+			inArchive.readSpan(&inVector[0], TSize);
+		} else {
+			for (glm::length_t i = 0; i < TSize; ++i) {
+				inArchive >> inVector[i];
+			}
 		}
 		return inArchive;
 	}
 
+	// Columns are contiguous, so writing column by column is the same as writing the matrix's memory
 	template <glm::length_t TCSize, glm::length_t TRSize, typename TType>
 	friend CArchive& operator<<(CArchive& inArchive, const glm::mat<TCSize, TRSize, TType>& inMatrix) {
-		for (glm::length_t c = 0; c < TCSize; ++c) {
-			for (glm::length_t r = 0; r < TRSize; ++r) {
-				inArchive << inMatrix[c][r];
+		if constexpr (TBitwiseSerializable<glm::mat<TCSize, TRSize, TType>>::value) {
+			inArchive.writeSpan(&inMatrix[0][0], TCSize * TRSize);
+		} else {
+			for (glm::length_t c = 0; c < TCSize; ++c) {
+				for (glm::length_t r = 0; r < TRSize; ++r) {
+					inArchive << inMatrix[c][r];
+				}
 			}
 		}
 		return inArchive;
@@ -83,9 +213,13 @@ public:
 
 	template <glm::length_t TCSize, glm::length_t TRSize, typename TType>
 	friend CArchive& operator>>(CArchive& inArchive, glm::mat<TCSize, TRSize, TType>& inMatrix) {
-		for (glm::length_t c = 0; c < TCSize; ++c) {
-			for (glm::length_t r = 0; r < TRSize; ++r) {
-				inArchive >> inMatrix[c][r];
+		if constexpr (TBitwiseSerializable<glm::mat<TCSize, TRSize, TType>>::value) {
+			inArchive.readSpan(&inMatrix[0][0], TCSize * TRSize);
+		} else {
+			for (glm::length_t c = 0; c < TCSize; ++c) {
+				for (glm::length_t r = 0; r < TRSize; ++r) {
+					inArchive >> inMatrix[c][r];
+				}
 			}
 		}
 		return inArchive;
@@ -243,11 +377,16 @@ public:
 	// Vectors
 	//
 	//TODO: inherited classes DO NOT work
+	// std::vector<bool> isn't contiguous, so it can't take the bulk path
 	template <typename TType>
 	friend CArchive& operator<<(CArchive& inArchive, const std::vector<TType>& inValue) {
 		inArchive << inValue.size();
-		for (const auto& value : inValue) {
-			inArchive << value;
+		if constexpr (TBitwiseSerializable<TType>::value && !std::is_same_v<TType, bool>) {
+			inArchive.writeSpan(inValue.data(), inValue.size());
+		} else {
+			for (const auto& value : inValue) {
+				inArchive << value;
+			}
 		}
 		return inArchive;
 	}
@@ -258,8 +397,12 @@ public:
 		size_t size;
 		inArchive >> size;
 		inValue.resize(size);
-		for (size_t i = 0; i < size; ++i) {
-			inArchive >> inValue[i];
+		if constexpr (TBitwiseSerializable<TType>::value && !std::is_same_v<TType, bool>) {
+			inArchive.readSpan(inValue.data(), size);
+		} else {
+			for (size_t i = 0; i < size; ++i) {
+				inArchive >> inValue[i];
+			}
 		}
 		return inArchive;
 	}
@@ -323,8 +466,12 @@ public:
 
 	template <typename TType, size_t _Size>
 	friend CArchive& operator<<(CArchive& inArchive, const std::array<TType, _Size>& inValue) {
-		for (auto value : inValue) {
-			inArchive << value;
+		if constexpr (TBitwiseSerializable<TType>::value) {
+			inArchive.writeSpan(inValue.data(), _Size);
+		} else {
+			for (const auto& value : inValue) {
+				inArchive << value;
+			}
 		}
 		return inArchive;
 	}
@@ -332,8 +479,12 @@ public:
 	// Since arrays have a set size, it does not need to be added to the save data
 	template <typename TType, size_t _Size>
 	friend CArchive& operator>>(CArchive& inArchive, std::array<TType, _Size>& inValue) {
-		for (size_t i = 0; i < _Size; ++i) {
-			inArchive >> inValue[i];
+		if constexpr (TBitwiseSerializable<TType>::value) {
+			inArchive.readSpan(inValue.data(), _Size);
+		} else {
+			for (size_t i = 0; i < _Size; ++i) {
+				inArchive >> inValue[i];
+			}
 		}
 		return inArchive;
 	}
@@ -371,7 +522,7 @@ public:
 	template <typename TType>
 	friend CArchive& operator<<(CArchive& inArchive, const TShared<TType>& inValue) {
 		if constexpr (std::is_base_of_v<SObject, TType>) {
-			inArchive << inValue->getClass()->getName();
+			inArchive.writeClass(inValue->getClass());
 			dynamic_cast<ISerializable*>(inValue.get())->save(inArchive);
 		} else {
 			inArchive << *inValue.get();
@@ -383,9 +534,7 @@ public:
 	requires std::is_default_constructible_v<TType>
 	friend CArchive& operator>>(CArchive& inArchive, TShared<TType>& inValue) {
 		if constexpr (std::is_base_of_v<SObject, TType>) {
-			std::string className;
-			inArchive >> className;
-			SClassRegistry::get()->getObjects().get(className)->constructObject(inValue);
+			inArchive.readClass()->constructObject(inValue);
 			dynamic_cast<ISerializable*>(inValue.get())->load(inArchive);
 		} else {
 			inArchive >> *inValue.get();
@@ -396,7 +545,7 @@ public:
 	template <typename TType>
 	friend CArchive& operator<<(CArchive& inArchive, const TUnique<TType>& inValue) {
 		if constexpr (std::is_base_of_v<SObject, TType>) {
-			inArchive << inValue->getClass()->getName();
+			inArchive.writeClass(inValue->getClass());
 			dynamic_cast<ISerializable*>(inValue.get())->save(inArchive);
 		} else {
 			inArchive << *inValue.get();
@@ -408,9 +557,7 @@ public:
 	requires std::is_default_constructible_v<TType>
 	friend CArchive& operator>>(CArchive& inArchive, TUnique<TType>& inValue) {
 		if constexpr (std::is_base_of_v<SObject, TType>) {
-			std::string className;
-			inArchive >> className;
-			SClassRegistry::get()->getObjects().get(className)->constructObject(inValue);
+			inArchive.readClass()->constructObject(inValue);
 			dynamic_cast<ISerializable*>(inValue.get())->load(inArchive);
 		} else {
 			inArchive >> *inValue.get();
@@ -430,7 +577,7 @@ public:
 		inValue.forEach([&](size_t index, const TType& obj) {
 			if constexpr (sstl::is_managed_v<TType> && std::is_base_of_v<SObject, typename TUnfurled<TType>::Type>) {
 				auto object = sstl::getUnfurled(obj);
-				inArchive << object->getClass()->getName();
+				inArchive.writeClass(object->getClass());
 				dynamic_cast<const ISerializable*>(object)->save(inArchive);
 			} else {
 				inArchive << obj;
@@ -446,9 +593,7 @@ public:
 		inValue.resize(size, [&](size_t) {
 			TType obj;
 			if constexpr (sstl::is_managed_v<TType> && std::is_base_of_v<SObject, typename TUnfurled<TType>::Type>) {
-				std::string className;
-				inArchive >> className;
-				SClassRegistry::get()->getObjects().get(className)->constructObject(obj);
+				inArchive.readClass()->constructObject(obj);
 				dynamic_cast<ISerializable*>(sstl::getUnfurled(obj))->load(inArchive);
 			} else {
 				inArchive >> obj;
@@ -458,12 +603,31 @@ public:
 		return inArchive;
 	}
 
+	// TVector is contiguous, so it gets the same bulk path as std::vector
+	template <typename TType>
+	requires TBitwiseSerializable<TType>::value
+	friend CArchive& operator<<(CArchive& inArchive, const TVector<TType>& inValue) {
+		inArchive << inValue.getSize();
+		inArchive.writeSpan(inValue.data(), inValue.getSize());
+		return inArchive;
+	}
+
+	template <typename TType>
+	requires TBitwiseSerializable<TType>::value
+	friend CArchive& operator>>(CArchive& inArchive, TVector<TType>& inValue) {
+		size_t size;
+		inArchive >> size;
+		inValue.resize(size, [](size_t) { return TType{}; });
+		inArchive.readSpan(inValue.data(), size);
+		return inArchive;
+	}
+
 	template <typename TType>
 	friend CArchive& operator<<(CArchive& inArchive, const TSingleAssociativeContainer<TType>& inValue) {
 		inArchive << inValue.getSize();
 		inValue.forEach([&](const TType& obj) {
 			if constexpr (std::is_base_of_v<SObject, typename TUnfurled<TType>::Type>) {
-				inArchive << obj->getClass()->getName();
+				inArchive.writeClass(obj->getClass());
 				dynamic_cast<const ISerializable*>(obj)->save(inArchive);
 			} else {
 				inArchive << obj;
@@ -479,9 +643,7 @@ public:
 		inValue.resize(size, [&] {
 			TType obj;
 			if constexpr (std::is_base_of_v<SObject, typename TUnfurled<TType>::Type>) {
-				std::string className;
-				inArchive >> className;
-				obj = SClassRegistry::get()->getObjects().get(className)->construct(inValue);
+				obj = inArchive.readClass()->construct(inValue);
 				dynamic_cast<ISerializable*>(obj)->load(inArchive);
 			} else {
 				inArchive >> obj;
@@ -497,7 +659,7 @@ public:
 		inValue.forEach([&](TPair<TKeyType, const TValueType&> pair) {
 			inArchive << pair.key;
 			if constexpr (std::is_base_of_v<SObject, typename TUnfurled<TValueType>::Type>) {
-				inArchive << pair.value->getClass()->getName();
+				inArchive.writeClass(pair.value->getClass());
 				dynamic_cast<const ISerializable*>(pair.value)->save(inArchive);
 			} else {
 				inArchive << pair.value;
@@ -514,9 +676,7 @@ public:
 			TPair<TKeyType, TValueType> pair;
 			inArchive >> pair.key;
 			if constexpr (std::is_base_of_v<SObject, typename TUnfurled<TValueType>::Type>) {
-				std::string className;
-				inArchive >> className;
-				pair.value = SClassRegistry::get()->getObjects().get(className)->construct(inValue);
+				pair.value = inArchive.readClass()->construct(inValue);
 				dynamic_cast<ISerializable*>(pair.value)->load(inArchive);
 			} else {
 				inArchive >> pair.value;
@@ -564,11 +724,55 @@ protected:
 
 	virtual void read(void* inValue, size_t inElementSize, size_t inCount) = 0;
 
+private:
+
+	SClassTable* m_ClassTable = nullptr;
+
 };
 
+inline CArchive& operator<<(CArchive& inArchive, const SClassTable& inTable) {
+	inArchive << inTable.mClasses.size();
+	for (const SClass* cls : inTable.mClasses) {
+		inArchive << cls->getId();
+		inArchive << cls->getName();
+	}
+	return inArchive;
+}
+
+// Classes are found by id, and by name if the id doesn't match anything
+// Classes that no longer exist stay in the table as null, so only objects that use them fail
+inline CArchive& operator>>(CArchive& inArchive, SClassTable& inTable) {
+	size_t size;
+	inArchive >> size;
+	inTable.mClasses.clear();
+	inTable.mIndices.clear();
+	for (size_t i = 0; i < size; ++i) {
+		uint64 id;
+		std::string name;
+		inArchive >> id;
+		inArchive >> name;
+
+		SClass* cls = SClassIdRegistry::get()->find(id);
+		if (!cls && SClassRegistry::get()->getObjects().contains(name)) {
+			cls = SClassRegistry::get()->getObjects().get(name).get();
+		}
+		if (!cls) {
+			msgs("Class {} in class table does not exist.", name);
+		}
+
+		inTable.mClasses.push_back(cls);
+		if (cls) inTable.mIndices.emplace(cls, static_cast<uint32>(i));
+	}
+	return inArchive;
+}
+
 // An archive that can process files, uses standard c since it is faster
+// Small writes are gathered into a block and flushed together, since every fwrite takes the stream's lock
 class CFileArchive final : public CArchive {
 
+	// Writes at least this big skip the buffer
+	constexpr static size_t m_WriteBufferSize = 64 * 1024;
+
 public:
 
 	// If archive goes out of scope, close the file
@@ -621,8 +825,9 @@ public:
 
 	// Function to write to entire file with any type
 	template <typename TType, class TAlloc = std::allocator<TType>>
-	void writeFile(std::vector<TType, TAlloc> vector) {
+	void writeFile(const std::vector<TType, TAlloc>& vector) {
 		assert(isOpen());
+		flush();
 		fwrite(vector.data(), sizeof(TType), vector.size(), mFile);
 
 		// Since every part of the file is read, we might as well close it
@@ -631,8 +836,9 @@ public:
 
 	// Function to write to entire file with any type
 	template <typename TType>
-	void writeFile(TVector<TType> vector) {
+	void writeFile(const TVector<TType>& vector) {
 		assert(isOpen());
+		flush();
 		fwrite(vector.data(), sizeof(TType), vector.getSize(), mFile);
 
 		// Since every part of the file is read, we might as well close it
@@ -642,14 +848,24 @@ public:
 	// Char has size of 1
 	void writeFile(const std::string &string) {
 		assert(isOpen());
+		flush();
 		fwrite(string.data(), 1, string.size(), mFile);
 
 		// Since every part of the file is read, we might as well close it
 		close();
 	}
 
+	// Writes out anything still waiting in the buffer
+	void flush() {
+		if (!m_WriteBuffer.empty()) {
+			fwrite(m_WriteBuffer.data(), 1, m_WriteBuffer.size(), mFile);
+			m_WriteBuffer.clear();
+		}
+	}
+
 	void close() {
 		if (isOpen()) {
+			flush();
 			fclose(mFile);
 			mIsOpen = false;
 		}
@@ -659,11 +875,31 @@ protected:
 
 	virtual void write(const void* inValue, const size_t inElementSize, const size_t inCount) override {
 		assert(isOpen());
-		fwrite(inValue, inElementSize, inCount, mFile);
+		const size_t size = inElementSize * inCount;
+
+		if (m_WriteBuffer.size() + size > m_WriteBufferSize) {
+			flush();
+		}
+
+		// Large blocks go straight to the file, there is nothing to gain by copying them first
+		if (size >= m_WriteBufferSize) {
+			fwrite(inValue, inElementSize, inCount, mFile);
+			return;
+		}
+
+		// Only files that are written to pay for the buffer
+		if (m_WriteBuffer.capacity() == 0) {
+			m_WriteBuffer.reserve(m_WriteBufferSize);
+		}
+
+		const size_t offset = m_WriteBuffer.size();
+		m_WriteBuffer.resize(offset + size);
+		memcpy(m_WriteBuffer.data() + offset, inValue, size);
 	}
 
 	virtual void read(void* inValue, size_t const inElementSize, const size_t inCount) override {
 		assert(isOpen());
+		flush();
 		fread(inValue, inElementSize, inCount, mFile);
 	}
 
@@ -672,4 +908,6 @@ private:
 	FILE* mFile;
 	bool mIsOpen = false;
 
+	std::vector<uint8> m_WriteBuffer;
+
 };
\ No newline at end of file
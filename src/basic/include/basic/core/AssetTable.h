@@ -0,0 +1,253 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "basic/core/Common.h"
+#include "sstl/Memory.h"
+
+// Refers to an asset in a TAssetTable, resolving it is an index and a generation check
+// A handle to a removed asset resolves to null instead of whatever took its slot
+template <typename TType>
+struct TAssetHandle {
+
+	constexpr static uint32 mInvalidIndex = std::numeric_limits<uint32>::max();
+
+	uint32 mIndex = mInvalidIndex;
+	uint32 mGeneration = 0;
+
+	no_discard bool isValid() const { return mIndex != mInvalidIndex; }
+
+	bool operator==(const TAssetHandle& inOther) const = default;
+};
+
+/*
+ * Assets of one type, stored in slots that are reused once their asset is removed
+ * Each slot counts how many times it has been reused, and a handle only resolves if its generation still matches
+ * Names go through an ordered index, which is only meant for loading and editing, anything per frame should hold a handle
+ *
+ * Loading and streaming tasks change the table alongside the game and render threads
+ * Changes and name lookups take a mutex, resolving a handle doesn't, it only reads atomics
+ * Slots are allocated in fixed blocks that are never moved or freed, so a resolve never sees storage that is being grown
+ *
+ * TStorage is how the asset is owned, assets never move once added so pointers to them stay valid until they are removed
+ * Adding never replaces an asset, since anything could be holding a pointer to it, it has to be removed explicitly
+ */
+template <typename TType, typename TStorage = TShared<TType>>
+class TAssetTable {
+
+	struct SSlot {
+		// Only touched under the mutex
+		std::optional<TStorage> mAsset;
+		std::string mName;
+
+		// What resolve reads, null while the slot is free
+		std::atomic<TType*> mPointer = nullptr;
+		std::atomic<uint32> mGeneration = 0;
+	};
+
+	constexpr static uint32 mSlotsPerBlock = 1024;
+
+	constexpr static uint32 mMaxBlocks = 1024;
+
+public:
+
+	typedef TAssetHandle<TType> Handle;
+
+	TAssetTable() = default;
+
+	TAssetTable(const TAssetTable&) = delete;
+	TAssetTable& operator=(const TAssetTable&) = delete;
+
+	~TAssetTable() {
+		clear();
+		for (auto& block : m_Blocks) {
+			delete[] block.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Like std::map::emplace, if an asset with the name already exists it is kept and the new one is dropped
+	// Returns the handle of the asset under the name, and if it was added
+	std::pair<Handle, bool> add(const std::string& inName, TStorage inAsset) {
+		std::lock_guard lock(m_Mutex);
+
+		// The new asset is dropped with the argument, after the lock is released
+		if (const auto itr = m_Names.find(inName); itr != m_Names.end()) {
+			return {itr->second, false};
+		}
+
+		uint32 index;
+		if (!m_FreeSlots.empty()) {
+			index = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		} else {
+			index = m_NumSlots.load(std::memory_order_relaxed);
+			asts(index < mSlotsPerBlock * mMaxBlocks, "Asset table is out of slots ({}).", index);
+
+			// Published before the slot count, so a resolve that sees the index also sees its block
+			if (index % mSlotsPerBlock == 0) {
+				m_Blocks[index / mSlotsPerBlock].store(new SSlot[mSlotsPerBlock], std::memory_order_release);
+			}
+			m_NumSlots.store(index + 1, std::memory_order_release);
+		}
+
+		SSlot& slot = getSlot(index);
+		slot.mAsset.emplace(std::move(inAsset));
+		slot.mName = inName;
+		slot.mPointer.store(getPointer(*slot.mAsset), std::memory_order_release);
+
+		const Handle handle{index, slot.mGeneration.load(std::memory_order_relaxed)};
+		m_Names.emplace(inName, handle);
+		return {handle, true};
+	}
+
+	// Anything still pointing at the asset is left dangling, only remove assets nothing can be using
+	bool remove(const Handle inHandle) {
+		std::optional<TStorage> removed;
+		{
+			std::lock_guard lock(m_Mutex);
+			if (!removeLocked(inHandle, removed)) return false;
+		}
+		return true;
+	}
+
+	bool remove(const std::string& inName) {
+		std::optional<TStorage> removed;
+		{
+			std::lock_guard lock(m_Mutex);
+			if (!removeLocked(findLocked(inName), removed)) return false;
+		}
+		return true;
+	}
+
+	// Null if the handle is invalid, or its asset has been removed
+	// Lock free, the generation is checked on both sides of reading the pointer so a slot reused in between is never returned
+	no_discard TType* resolve(const Handle inHandle) const {
+		if (inHandle.mIndex >= m_NumSlots.load(std::memory_order_acquire)) return nullptr;
+
+		const SSlot& slot = getSlot(inHandle.mIndex);
+		if (slot.mGeneration.load(std::memory_order_acquire) != inHandle.mGeneration) return nullptr;
+		TType* pointer = slot.mPointer.load(std::memory_order_acquire);
+		if (slot.mGeneration.load(std::memory_order_seq_cst) != inHandle.mGeneration) return nullptr;
+		return pointer;
+	}
+
+	// An invalid handle if there is no asset with that name
+	no_discard Handle find(const std::string& inName) const {
+		std::lock_guard lock(m_Mutex);
+		return findLocked(inName);
+	}
+
+	no_discard bool contains(const std::string& inName) const {
+		std::lock_guard lock(m_Mutex);
+		return m_Names.contains(inName);
+	}
+
+	// The name of a live asset, empty otherwise
+	no_discard std::string getName(const Handle inHandle) const {
+		std::lock_guard lock(m_Mutex);
+		return resolve(inHandle) ? getSlot(inHandle.mIndex).mName : std::string{};
+	}
+
+	// Every live asset by name, in order
+	// A copy, since the table can change as soon as the lock is released
+	no_discard std::map<std::string, Handle> getNames() const {
+		std::lock_guard lock(m_Mutex);
+		return m_Names;
+	}
+
+	no_discard size_t size() const {
+		std::lock_guard lock(m_Mutex);
+		return m_Names.size();
+	}
+
+	no_discard bool empty() const {
+		std::lock_guard lock(m_Mutex);
+		return m_Names.empty();
+	}
+
+	// Visits every asset in name order, as it is stored
+	// The assets are gathered under the lock and visited after it is released, so the function is free to use the table
+	// An asset removed while it is being visited is left dangling, like any other pointer to it
+	template <typename TFunc>
+	void forEach(TFunc&& inFunc) {
+		std::vector<std::tuple<std::string, Handle, TStorage*>> assets;
+		{
+			std::lock_guard lock(m_Mutex);
+			assets.reserve(m_Names.size());
+			for (const auto& [name, handle] : m_Names) {
+				assets.emplace_back(name, handle, &*getSlot(handle.mIndex).mAsset);
+			}
+		}
+
+		for (const auto& [name, handle, asset] : assets) {
+			inFunc(name, handle, *asset);
+		}
+	}
+
+	void clear() {
+		std::vector<TStorage> removed;
+		{
+			std::lock_guard lock(m_Mutex);
+			while (!m_Names.empty()) {
+				std::optional<TStorage> asset;
+				removeLocked(m_Names.begin()->second, asset);
+				removed.push_back(std::move(*asset));
+			}
+		}
+	}
+
+private:
+
+	static TType* getPointer(TStorage& inAsset) {
+		if constexpr (std::is_same_v<TStorage, TType>) {
+			return &inAsset;
+		} else {
+			return inAsset.get();
+		}
+	}
+
+	SSlot& getSlot(const uint32 inIndex) const {
+		return m_Blocks[inIndex / mSlotsPerBlock].load(std::memory_order_acquire)[inIndex % mSlotsPerBlock];
+	}
+
+	Handle findLocked(const std::string& inName) const {
+		const auto itr = m_Names.find(inName);
+		return itr == m_Names.end() ? Handle{} : itr->second;
+	}
+
+	// The asset is moved out instead of destroyed, so it can be destroyed once the lock is released
+	// The generation is bumped before the pointer is cleared, so a resolve racing this sees the change and returns null
+	bool removeLocked(const Handle inHandle, std::optional<TStorage>& outRemoved) {
+		if (!resolve(inHandle)) return false;
+
+		SSlot& slot = getSlot(inHandle.mIndex);
+		slot.mGeneration.fetch_add(1, std::memory_order_seq_cst);
+		slot.mPointer.store(nullptr, std::memory_order_release);
+		m_Names.erase(slot.mName);
+		outRemoved = std::move(slot.mAsset);
+		slot.mAsset.reset();
+		slot.mName.clear();
+		m_FreeSlots.push_back(inHandle.mIndex);
+		return true;
+	}
+
+	std::array<std::atomic<SSlot*>, mMaxBlocks> m_Blocks{};
+
+	std::atomic<uint32> m_NumSlots = 0;
+
+	std::vector<uint32> m_FreeSlots;
+
+	std::map<std::string, Handle> m_Names;
+
+	mutable std::mutex m_Mutex;
+
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <deque>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "basic/core/MappedArchive.h"
+#include "basic/core/MemoryArchive.h"
+
+/*
+ * Chunk files are a header, a set of typed and versioned chunks, and a table of contents at the end
+ * Each chunk starts aligned and has its own checksum, so a loader can map the file,
+ * go straight to the chunks it needs, and ignore ones it doesn't know about
+ *
+ * [SChunkFileHeader] [chunk] [chunk] ... [SChunkEntry * chunk count]
+ *
+ * Chunks that shrink enough are stored LZ4 compressed, readers decompress them transparently
+ */
+
+// Chunk types are four characters, so they are readable in a hex editor
+constexpr uint32 makeChunkType(const char (&inName)[5]) {
+	return static_cast<uint32>(inName[0]) | static_cast<uint32>(inName[1]) << 8 | static_cast<uint32>(inName[2]) << 16 | static_cast<uint32>(inName[3]) << 24;
+}
+
+struct SChunkFileHeader {
+	constexpr static bool mBitwiseSerializable = true;
+
+	constexpr static uint32 mExpectedMagic = makeChunkType("STRC");
+
+	// Bumped when the container itself changes, chunks have their own versions
+	// 2: polymorphic objects are stored as an index into the file's class table
+	// 3: chunks can be LZ4 compressed
+	constexpr static uint32 mCurrentVersion = 3;
+
+	uint32 mMagic = mExpectedMagic;
+	uint32 mVersion = mCurrentVersion;
+	uint32 mChunkCount = 0;
+	uint32 mFlags = 0;
+	uint64 mTableOffset = 0;
+};
+
+enum class EChunkFlags : uint32 {
+	NONE = 0,
+	// Stored as the uncompressed size followed by a single LZ4 block
+	LZ4 = 1 << 0
+};
+
+struct SChunkEntry {
+	constexpr static bool mBitwiseSerializable = true;
+
+	uint32 mType = 0;
+	uint32 mVersion = 0;
+	uint64 mOffset = 0;
+	// Size as stored, so compressed chunks are the compressed size
+	uint64 mSize = 0;
+	// Of the stored bytes, so damage is caught before decompressing
+	uint32 mChecksum = 0;
+	uint32 mFlags = 0;
+
+	no_discard bool isCompressed() const {
+		return (mFlags & static_cast<uint32>(EChunkFlags::LZ4)) != 0;
+	}
+};
+
+static_assert(sizeof(SChunkFileHeader) == 24 && sizeof(SChunkEntry) == 32, "Chunk file structures are written as is, so they can't have padding.");
+
+// Chunks start on this boundary, so their data can be used in place from a mapped file
+constexpr static size_t gChunkAlignment = 16;
+
+// Written by the writer itself, holds the classes of every polymorphic object in the file
+constexpr static uint32 gClassTableChunk = makeChunkType("CLSS");
+
+EXPORT uint32 getChecksum(std::span<const uint8> inData);
+
+// Replaces the file atomically, readers see either the old file or the new one, never a partial write
+EXPORT bool writeFileAtomic(const std::string& inFilePath, std::span<const uint8> inData);
+
+// Gathers chunks in memory, then writes the whole file at once
+// Every chunk shares one class table, so each class name is only stored once per file
+class CChunkWriter {
+
+public:
+
+	// Compression can be turned off for data that is already compressed, or files that are rewritten constantly
+	explicit CChunkWriter(const bool inCompress = true)
+		: m_Compress(inCompress) {}
+
+	// The chunk archives point at the writer's class table
+	CChunkWriter(const CChunkWriter&) = delete;
+	CChunkWriter& operator=(const CChunkWriter&) = delete;
+
+	// Starts a new chunk, and returns the archive to serialize it with
+	// The archive stays valid until the writer is destroyed
+	CMemoryArchive& addChunk(const uint32 inType, const uint32 inVersion) {
+		CMemoryArchive& archive = m_Chunks.emplace_back(inType, inVersion).mData;
+		archive.setClassTable(&m_ClassTable);
+		return archive;
+	}
+
+	template <typename TType>
+	void addChunk(const uint32 inType, const uint32 inVersion, const TType& inValue) {
+		addChunk(inType, inVersion) << inValue;
+	}
+
+	// Raw bytes, stored without a size since the table already has it
+	void addChunkData(const uint32 inType, const uint32 inVersion, const std::span<const uint8> inData) {
+		addChunk(inType, inVersion).writeSpan(inData.data(), inData.size());
+	}
+
+	// Lays out the header, chunks and table into a single buffer
+	// Chunks are compressed in parallel at the caller's priority, so a save running on the background pool stays there
+	EXPORT std::vector<uint8> finish() const;
+
+	// See writeFileAtomic
+	EXPORT bool writeToFile(const std::string& inFilePath) const;
+
+private:
+
+	struct SChunk {
+		SChunk(const uint32 inType, const uint32 inVersion)
+			: mType(inType), mVersion(inVersion) {}
+
+		uint32 mType;
+		uint32 mVersion;
+		CMemoryArchive mData;
+	};
+
+	// Deque so the archives handed out don't move when more chunks are added
+	std::deque<SChunk> m_Chunks;
+
+	SClassTable m_ClassTable;
+
+	bool m_Compress;
+
+};
+
+// Maps a chunk file and reads chunks out of it on demand
+class CChunkReader {
+
+public:
+
+	EXPORT explicit CChunkReader(const std::string& inFilePath);
+
+	no_discard bool isOpen() const { return m_File.isOpen(); }
+
+	// False for files that were written as a plain stream, before chunk files existed
+	no_discard bool isChunkFile() const { return m_IsChunkFile; }
+
+	// Gives access to the whole file, to read files that aren't chunk files
+	no_discard CMappedArchive& getArchive() { return m_File; }
+
+	no_discard const std::vector<SChunkEntry>& getEntries() const { return m_Entries; }
+
+	EXPORT const SChunkEntry* find(uint32 inType) const;
+
+	no_discard bool has(const uint32 inType) const { return find(inType) != nullptr; }
+
+	// Zero if the chunk doesn't exist
+	no_discard uint32 getVersion(const uint32 inType) const {
+		const SChunkEntry* entry = find(inType);
+		return entry ? entry->mVersion : 0;
+	}
+
+	// The chunk's data, empty if it is missing or fails its checksum
+	// Points into the mapping, or into the reader's own buffer if the chunk was compressed
+	EXPORT std::span<const uint8> getChunkData(uint32 inType);
+
+	// Decompresses every compressed chunk up front, spread over the pool at the caller's priority
+	// Otherwise chunks are decompressed one at a time as they are opened
+	EXPORT void decompressAll();
+
+	// Moves to the start of a chunk and returns the archive to read it with
+	// Null if the chunk is missing or fails its checksum
+	EXPORT CArchive* openChunk(uint32 inType);
+
+	// Deserializes a chunk, returns false if it is missing or fails its checksum
+	template <typename TType>
+	bool read(const uint32 inType, TType& outValue) {
+		CArchive* archive = openChunk(inType);
+		if (!archive) return false;
+
+		*archive >> outValue;
+		asts(getChunkPosition() <= m_ChunkEnd, "Chunk {:08x} read past its end.", inType);
+		return true;
+	}
+
+private:
+
+	no_discard size_t getChunkPosition() const {
+		return m_OpenChunk ? m_OpenChunk->getPosition() : m_File.getPosition();
+	}
+
+	EXPORT bool verify(const SChunkEntry& inEntry) const;
+
+	// Decompresses into the chunk's buffer if it hasn't been already
+	EXPORT bool decompress(size_t inIndex);
+
+	CMappedArchive m_File;
+
+	std::vector<SChunkEntry> m_Entries;
+
+	// Compressed chunks once decompressed, empty for everything else
+	std::vector<CMemoryArchive> m_Decompressed;
+
+	// The decompressed chunk being read, null when reading from the mapping
+	CMemoryArchive* m_OpenChunk = nullptr;
+
+	SClassTable m_ClassTable;
+
+	size_t m_ChunkEnd = 0;
+
+	bool m_IsChunkFile = false;
+
+};
+
+// Reads a single value stored in one chunk, or a file that is still the plain stream from before chunk files
+template <typename TType>
+bool readChunkFile(const std::string& inFilePath, const uint32 inType, TType& outValue) {
+	CChunkReader reader(inFilePath);
+	if (!reader.isOpen()) return false;
+
+	if (!reader.isChunkFile()) {
+		reader.getArchive() >> outValue;
+		return true;
+	}
+
+	return reader.read(inType, outValue);
+}
+
+// Writes a single value as a chunk file with one chunk
+template <typename TType>
+bool writeChunkFile(const std::string& inFilePath, const uint32 inType, const uint32 inVersion, const TType& inValue) {
+	CChunkWriter writer;
+	writer.addChunk(inType, inVersion, inValue);
+	return writer.writeToFile(inFilePath);
+}
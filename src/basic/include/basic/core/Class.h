@@ -1,6 +1,7 @@
 #pragma once
 
 #include <type_traits>
+#include <unordered_map>
 
 #include "Registry.h"
 #include "basic/core/Object.h"
@@ -29,12 +30,17 @@ struct SClass : SObject {
 
 	SClass() = delete;
 
-	SClass(const std::string& inName): m_Name(inName) {}
+	SClass(const std::string& inName): m_Name(inName), m_Id(getStableHash(inName)) {}
 
 	virtual std::string getName() const {
 		return m_Name;
 	}
 
+	// Hash of the name, stays the same between runs so it can be saved
+	uint64 getId() const {
+		return m_Id;
+	}
+
 	virtual bool isAbstract() const = 0;
 
 	virtual void constructObject(SObject&) const = 0;
@@ -58,10 +64,35 @@ struct SClass : SObject {
 	// Name of the current class
 	std::string m_Name;
 
+	uint64 m_Id;
+
 };
 
 DEFINE_REGISTRY(SClassRegistry, TUnique<SClass>)
 
+// Finds classes by id, which is a single hash lookup instead of comparing names
+class SClassIdRegistry : public SObject {
+
+	CUSTOM_SINGLETON(SClassIdRegistry, "")
+
+public:
+
+	SClass* find(const uint64 inId) const {
+		const auto itr = m_Classes.find(inId);
+		return itr == m_Classes.end() ? nullptr : itr->second;
+	}
+
+	void add(SClass* inClass) {
+		const auto [itr, inserted] = m_Classes.emplace(inClass->getId(), inClass);
+		asts(inserted || itr->second == inClass, "Classes {} and {} have the same id.", itr->second->getName(), inClass->getName());
+	}
+
+private:
+
+	std::unordered_map<uint64, SClass*> m_Classes;
+
+};
+
 template <typename... TParentClasses>
 //requires std::is_base_of_v<SObject, TType>
 struct TClass : SClass {
@@ -152,6 +183,7 @@ template <typename TClassType>
 TClassType* makeClass(const std::string& inName) {
 	if (!SClassRegistry::get()->getObjects().contains(inName)) {
 		SClassRegistry::get()->getObjects().push(inName, TUnique<TClassType>{inName});
+		SClassIdRegistry::get()->add(SClassRegistry::get()->getObjects().get(inName).get());
 	}
 	return static_cast<TClassType*>(SClassRegistry::get()->getObjects().get(inName).get());
 }
\ No newline at end of file
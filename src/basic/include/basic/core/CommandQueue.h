@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "basic/core/Common.h"
+#include "basic/core/TaskFunction.h"
+
+// The default storage size fills a two cache line slot
+template <typename TSignature, size_t TCapacity, size_t TStorageSize = 104>
+class TCommandQueue;
+
+/*
+ * Bounded lock-free multiple producer, single consumer queue of callables
+ * Each slot stores its callable inline (larger ones fall back to STaskAllocator), so pushing a command doesn't hit the heap
+ * Slots carry a sequence number that tells producers and the consumer whose turn it is (Vyukov)
+ * https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ */
+
+template <typename... TArgs, size_t TCapacity, size_t TStorageSize>
+class TCommandQueue<void(TArgs...), TCapacity, TStorageSize> {
+
+	static_assert(TCapacity >= 2 && (TCapacity & (TCapacity - 1)) == 0, "Command queue capacity must be a power of two.");
+
+	// Each slot gets its own cache line(s), so neighbouring producers don't fight over them
+	struct alignas(64) SSlot {
+		std::atomic<uint64> mSequence;
+		TTaskFunction<void(TArgs...), TStorageSize> mCommand;
+	};
+
+	constexpr static uint64 mMask = TCapacity - 1;
+
+public:
+
+	TCommandQueue()
+	: m_Slots(std::make_unique<SSlot[]>(TCapacity)) {
+		for (uint64 i = 0; i < TCapacity; ++i) {
+			m_Slots[i].mSequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	~TCommandQueue() {
+		clear();
+	}
+
+	TCommandQueue(const TCommandQueue&) = delete;
+	TCommandQueue& operator=(const TCommandQueue&) = delete;
+
+	constexpr static size_t getCapacity() { return TCapacity; }
+
+	// Not exact if other threads are modifying the queue
+	no_discard size_t getSize() const {
+		const uint64 tail = m_Tail.load(std::memory_order_relaxed);
+		const uint64 head = m_Head.load(std::memory_order_relaxed);
+		return tail > head ? static_cast<size_t>(tail - head) : 0;
+	}
+
+	no_discard bool isEmpty() const {
+		return getSize() == 0;
+	}
+
+	// Any thread, returns false without touching the callable if the queue is full
+	template <typename TFunc>
+	requires std::is_invocable_r_v<void, std::decay_t<TFunc>&, TArgs...>
+	bool push(TFunc&& inFunc) {
+		SSlot* slot;
+		uint64 position = m_Tail.load(std::memory_order_relaxed);
+		while (true) {
+			slot = &m_Slots[position & mMask];
+			const uint64 sequence = slot->mSequence.load(std::memory_order_acquire);
+			const int64 difference = static_cast<int64>(sequence) - static_cast<int64>(position);
+
+			// Slot is free for this position, try to claim it
+			if (difference == 0) {
+				if (m_Tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			// Consumer hasn't freed this slot yet, so the queue is full
+			else if (difference < 0) {
+				return false;
+			}
+			// Another producer claimed it first
+			else {
+				position = m_Tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->mCommand.emplace(std::forward<TFunc>(inFunc));
+
+		// Publish to the consumer
+		slot->mSequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, runs the oldest command and returns false if there is none
+	bool executeOne(TArgs... inArgs) {
+		const uint64 position = m_Head.load(std::memory_order_relaxed);
+		SSlot& slot = m_Slots[position & mMask];
+
+		// Either empty, or a producer has claimed the slot but not finished writing it
+		if (slot.mSequence.load(std::memory_order_acquire) != position + 1) {
+			return false;
+		}
+
+		slot.mCommand(std::forward<TArgs>(inArgs)...);
+		slot.mCommand.reset();
+
+		// Hand the slot back to producers for its next lap around the ring
+		m_Head.store(position + 1, std::memory_order_relaxed);
+		slot.mSequence.store(position + TCapacity, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, commands pushed while this runs may or may not be executed
+	size_t executeAll(TArgs... inArgs) {
+		size_t executed = 0;
+		while (executeOne(inArgs...)) {
+			executed++;
+		}
+		return executed;
+	}
+
+	// Consumer only, destroys any pending commands without running them
+	void clear() {
+		uint64 position = m_Head.load(std::memory_order_relaxed);
+		while (true) {
+			SSlot& slot = m_Slots[position & mMask];
+			if (slot.mSequence.load(std::memory_order_acquire) != position + 1) break;
+			slot.mCommand.reset();
+			slot.mSequence.store(position + TCapacity, std::memory_order_release);
+			position++;
+		}
+		m_Head.store(position, std::memory_order_relaxed);
+	}
+
+private:
+
+	// Head is only written by the consumer and tail by producers, so keep them on separate cache lines
+	alignas(64) std::atomic<uint64> m_Head = 0;
+	alignas(64) std::atomic<uint64> m_Tail = 0;
+
+	std::unique_ptr<SSlot[]> m_Slots;
+};
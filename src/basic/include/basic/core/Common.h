@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <iostream>
+#include <string_view>
 #include "fmt/format.h"
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
@@ -119,6 +120,16 @@ typedef signed int int32;
 typedef unsigned long long uint64;
 typedef signed long long int64;
 
+// FNV-1a, unlike getHash it is the same on every platform, so it can be stored in files
+constexpr uint64 getStableHash(const std::string_view inString) {
+	uint64 hash = 0xcbf29ce484222325ull;
+	for (const char c : inString) {
+		hash ^= static_cast<uint8>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
 typedef union {
 	float f;
 	uint32 i;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+
+#include "basic/core/ChunkArchive.h"
+#include "basic/core/Hash.h"
+#include "basic/core/Singleton.h"
+
+/*
+ * Cooked results of imports, stored under the cache path by a hash of everything that went into them
+ * A hit skips the importer entirely, so a key has to cover the source bytes and every setting that changes the output
+ * Importers should also hash a version of their own, and bump it whenever their output changes
+ *
+ * Entries are chunk files with a single chunk, so a damaged entry fails its checksum and counts as a miss
+ */
+class CDerivedDataCache : public SObject {
+
+	REGISTER_CLASS(CDerivedDataCache, SObject)
+	MAKE_SINGLETON(CDerivedDataCache)
+
+public:
+
+	// Bumped when the entry format changes, which drops every entry
+	constexpr static uint32 mEntryVersion = 1;
+
+	constexpr static uint32 mEntryChunk = makeChunkType("DDCE");
+
+	struct SStats {
+		uint64 mHits = 0;
+		uint64 mMisses = 0;
+		uint64 mBytesRead = 0;
+		uint64 mBytesWritten = 0;
+	};
+
+	template <typename TType>
+	static bool load(const SHash& inKey, TType& outValue) {
+		const std::filesystem::path path = getEntryPath(inKey);
+
+		CChunkReader reader(path.string());
+		const bool hit = reader.isChunkFile() && reader.getVersion(mEntryChunk) == mEntryVersion && reader.read(mEntryChunk, outValue);
+
+		get()->recordLookup(hit, hit ? reader.getArchive().getSize() : 0);
+		return hit;
+	}
+
+	// Entries are never compressed by the writer, what is cooked here is usually compressed already
+	template <typename TType>
+	static bool store(const SHash& inKey, const TType& inValue) {
+		CChunkWriter writer(false);
+		writer.addChunk(mEntryChunk, mEntryVersion, inValue);
+		const std::vector<uint8> data = writer.finish();
+
+		const bool written = writeFileAtomic(getEntryPath(inKey).string(), data);
+		if (written) get()->m_BytesWritten += data.size();
+		return written;
+	}
+
+	EXPORT static std::filesystem::path getEntryPath(const SHash& inKey);
+
+	EXPORT static SStats getStats();
+
+private:
+
+	EXPORT void recordLookup(bool inHit, size_t inSize);
+
+	std::atomic<uint64> m_Hits = 0;
+	std::atomic<uint64> m_Misses = 0;
+	std::atomic<uint64> m_BytesRead = 0;
+	std::atomic<uint64> m_BytesWritten = 0;
+
+};
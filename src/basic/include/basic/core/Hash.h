@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <string>
+
+#include "basic/core/Common.h"
+
+// A SHA-256 digest, for keys that have to stay unique across every file they are made from
+struct SHash {
+	constexpr static bool mBitwiseSerializable = true;
+
+	std::array<uint8, 32> mBytes{};
+
+	// Lowercase hex, so it can be used as a file name
+	EXPORT std::string toString() const;
+
+	bool operator==(const SHash& inOther) const = default;
+};
+
+// Builds a hash incrementally, so a key can cover several files and settings without joining them first
+class CHasher {
+
+public:
+
+	EXPORT CHasher();
+
+	EXPORT void update(std::span<const uint8> inData);
+
+	void update(const std::string& inString) {
+		// The size goes in first, so "ab" + "c" and "a" + "bc" are different keys
+		update(static_cast<uint64>(inString.size()));
+		update(std::span{reinterpret_cast<const uint8*>(inString.data()), inString.size()});
+	}
+
+	template <typename TType>
+	requires std::is_arithmetic_v<TType> || std::is_enum_v<TType>
+	void update(const TType& inValue) {
+		update(std::span{reinterpret_cast<const uint8*>(&inValue), sizeof(TType)});
+	}
+
+	// The hasher can't be updated after this
+	EXPORT SHash finish();
+
+private:
+
+	void compress(const uint8* inBlock);
+
+	std::array<uint32, 8> m_State;
+
+	std::array<uint8, 64> m_Block{};
+
+	size_t m_BlockSize = 0;
+
+	uint64 m_TotalSize = 0;
+
+};
+
+inline SHash getHash(const std::span<const uint8> inData) {
+	CHasher hasher;
+	hasher.update(inData);
+	return hasher.finish();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sstl/List.h"
+#include "basic/core/Threading.h"
 
 template <typename TType>
 struct THierarchy {
@@ -26,6 +27,17 @@ struct THierarchy {
 		(m_Children.pop(std::forward<TArgs>(args)), ...);
 	}
 
+	// Runs a function on every direct child across the thread pool
+	template <typename TFunc>
+	void forEachChildParallel(const size_t inGrainSize, TFunc&& inFunc) {
+		CThreading::parallelFor(m_Children, inGrainSize, std::forward<TFunc>(inFunc));
+	}
+
+	template <typename TFunc>
+	void forEachChildParallel(const size_t inGrainSize, TFunc&& inFunc) const {
+		CThreading::parallelFor(m_Children, inGrainSize, std::forward<TFunc>(inFunc));
+	}
+
 	TUnique<TType>& operator[](const size_t index) {
 		return m_Children[index];
 	}
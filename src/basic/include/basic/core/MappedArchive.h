@@ -0,0 +1,82 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+#include "basic/core/Archive.h"
+
+/*
+ * Read only archive over a memory mapped file
+ * Reads copy straight out of the page cache instead of going through fread's buffer
+ * Large blobs can be viewed in place, so they never need to be copied into a vector first
+ * Views point into the mapping, so they are only valid while the archive is open
+ */
+class CMappedArchive final : public CArchive {
+
+public:
+
+	EXPORT explicit CMappedArchive(const std::string& inFilePath);
+
+	explicit CMappedArchive(const char* inFilePath)
+		: CMappedArchive(std::string(inFilePath)) {}
+
+	virtual ~CMappedArchive() override {
+		close();
+	}
+
+	CMappedArchive(const CMappedArchive&) = delete;
+	CMappedArchive& operator=(const CMappedArchive&) = delete;
+
+	no_discard bool isOpen() const { return m_IsOpen; }
+
+	no_discard size_t getSize() const { return m_Size; }
+
+	no_discard size_t getPosition() const { return m_Position; }
+
+	void seek(const size_t inPosition) {
+		asts(inPosition <= m_Size, "Seeking to {} in a mapped file of {} bytes.", inPosition, m_Size);
+		m_Position = inPosition;
+	}
+
+	// The whole file
+	no_discard std::span<const uint8> getData() const {
+		return {m_Data, m_Size};
+	}
+
+	// Views the next bytes and moves past them
+	EXPORT std::span<const uint8> view(size_t inSize);
+
+	// Views a vector that was written with operator<<, without copying it out of the mapping
+	// The data isn't necessarily aligned for TType, so it is handed out as bytes
+	template <typename TType>
+	requires TBitwiseSerializable<TType>::value
+	std::span<const uint8> viewVector() {
+		size_t size;
+		*this >> size;
+		return view(size * sizeof(TType));
+	}
+
+	EXPORT void close();
+
+protected:
+
+	virtual void write(const void* inValue, size_t inElementSize, size_t inCount) override {
+		astsNoEntry();
+	}
+
+	virtual void read(void* inValue, const size_t inElementSize, const size_t inCount) override {
+		const std::span<const uint8> bytes = view(inElementSize * inCount);
+		memcpy(inValue, bytes.data(), bytes.size());
+	}
+
+private:
+
+	const uint8* m_Data = nullptr;
+
+	size_t m_Size = 0;
+
+	size_t m_Position = 0;
+
+	bool m_IsOpen = false;
+
+};
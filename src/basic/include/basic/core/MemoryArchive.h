@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "basic/core/Archive.h"
+
+/*
+ * Archive over a growable block of memory
+ * Writes append to one contiguous buffer, so a whole object graph can be serialized without touching the disk
+ * and then written out in one go, sent over the network, or kept around as an undo state
+ * Reads go from the front, and can be rewound to read the same data again
+ */
+class CMemoryArchive final : public CArchive {
+
+public:
+
+	CMemoryArchive() = default;
+
+	// Reads from data that already exists, like a received snapshot
+	explicit CMemoryArchive(std::vector<uint8> inData)
+		: m_Data(std::move(inData)) {}
+
+	no_discard const std::vector<uint8>& getData() const { return m_Data; }
+
+	no_discard size_t getSize() const { return m_Data.size(); }
+
+	no_discard size_t getPosition() const { return m_ReadPosition; }
+
+	no_discard bool isAtEnd() const { return m_ReadPosition >= m_Data.size(); }
+
+	void reserve(const size_t inSize) {
+		m_Data.reserve(inSize);
+	}
+
+	void seek(const size_t inPosition) {
+		asts(inPosition <= m_Data.size(), "Seeking to {} in a memory archive of {} bytes.", inPosition, m_Data.size());
+		m_ReadPosition = inPosition;
+	}
+
+	void rewind() {
+		m_ReadPosition = 0;
+	}
+
+	// Keeps the capacity, so an archive reused every frame stops allocating once it has grown
+	void clear() {
+		m_Data.clear();
+		m_ReadPosition = 0;
+	}
+
+	// Hands the buffer off, leaving the archive empty
+	no_discard std::vector<uint8> takeData() {
+		m_ReadPosition = 0;
+		return std::move(m_Data);
+	}
+
+	// Writes everything in a single call
+	bool writeToFile(const std::string& inFilePath) const {
+		CFileArchive file(inFilePath, "wb");
+		if (!file.isOpen()) return false;
+		file.writeFile(m_Data);
+		return true;
+	}
+
+protected:
+
+	virtual void write(const void* inValue, const size_t inElementSize, const size_t inCount) override {
+		const size_t size = inElementSize * inCount;
+		const size_t offset = m_Data.size();
+		m_Data.resize(offset + size);
+		memcpy(m_Data.data() + offset, inValue, size);
+	}
+
+	virtual void read(void* inValue, const size_t inElementSize, const size_t inCount) override {
+		const size_t size = inElementSize * inCount;
+		asts(size <= m_Data.size() - m_ReadPosition, "Reading {} bytes at {} past the end of a memory archive of {} bytes.", size, m_ReadPosition, m_Data.size());
+		memcpy(inValue, m_Data.data() + m_ReadPosition, size);
+		m_ReadPosition += size;
+	}
+
+private:
+
+	std::vector<uint8> m_Data;
+
+	size_t m_ReadPosition = 0;
+
+};
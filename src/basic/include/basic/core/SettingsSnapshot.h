@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "basic/core/Common.h"
+
+// The value of an engine setting, which member is used depends on the setting's type
+struct SCommandValue {
+	union {
+		bool bValue;
+		struct {
+			int32 val;
+			int32 min;
+			int32 max;
+		} iValue;
+		struct {
+			float val;
+			float min;
+			float max;
+		} fValue;
+		Extent32 extent;
+		Vector2f vector2;
+		Vector3f vector3;
+		Vector4f vector4;
+	};
+};
+
+/*
+ * A copy of the engine settings, taken by the game thread and handed to the render thread with each frame
+ * Texts and values are indexed in the order their settings were registered
+ */
+struct SSettingsSnapshot {
+	std::vector<std::string> mTexts;
+	std::vector<SCommandValue> mValues;
+};
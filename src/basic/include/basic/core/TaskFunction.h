@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "basic/core/Common.h"
+
+/*
+ * Fixed size blocks for tasks that don't fit inline
+ * Freed blocks go to a per thread free list, so steady state allocation never touches the heap or a lock
+ */
+struct STaskAllocator {
+
+	// Anything larger goes straight to the heap
+	constexpr static size_t mMaxBlockSize = 512;
+
+	EXPORT static void* allocate(size_t inSize);
+
+	EXPORT static void deallocate(void* inBlock, size_t inSize);
+};
+
+template <typename TSignature, size_t TInlineSize = 56>
+class TTaskFunction;
+
+/*
+ * Move-only type erased callable, a replacement for std::function in task queues
+ * Callables that fit in TInlineSize bytes are stored inline, larger ones use STaskAllocator
+ * With the default size the whole object is one cache line
+ */
+template <typename TReturn, typename... TArgs, size_t TInlineSize>
+class TTaskFunction<TReturn(TArgs...), TInlineSize> {
+
+	struct SOperations {
+		TReturn (*mInvoke)(void* inStorage, TArgs&&... inArgs);
+		// Move constructs into outStorage and destroys inStorage
+		void (*mRelocate)(void* inStorage, void* outStorage);
+		void (*mDestroy)(void* inStorage);
+	};
+
+	template <typename TFunc>
+	constexpr static bool isInline = sizeof(TFunc) <= TInlineSize && std::is_nothrow_move_constructible_v<TFunc>;
+
+	template <typename TFunc>
+	static TFunc* get(void* inStorage) {
+		if constexpr (isInline<TFunc>) {
+			return std::launder(static_cast<TFunc*>(inStorage));
+		} else {
+			return *static_cast<TFunc**>(inStorage);
+		}
+	}
+
+	template <typename TFunc>
+	constexpr static SOperations mOperations {
+		[](void* inStorage, TArgs&&... inArgs) -> TReturn {
+			return std::invoke(*get<TFunc>(inStorage), std::forward<TArgs>(inArgs)...);
+		},
+		[](void* inStorage, void* outStorage) {
+			if constexpr (isInline<TFunc>) {
+				TFunc* func = get<TFunc>(inStorage);
+				new (outStorage) TFunc(std::move(*func));
+				func->~TFunc();
+			} else {
+				// Only the pointer moves
+				*static_cast<TFunc**>(outStorage) = *static_cast<TFunc**>(inStorage);
+			}
+		},
+		[](void* inStorage) {
+			TFunc* func = get<TFunc>(inStorage);
+			func->~TFunc();
+			if constexpr (!isInline<TFunc>) {
+				STaskAllocator::deallocate(func, sizeof(TFunc));
+			}
+		}
+	};
+
+public:
+
+	TTaskFunction() = default;
+
+	TTaskFunction(std::nullptr_t) {}
+
+	template <typename TFunc>
+	requires (!std::is_same_v<std::decay_t<TFunc>, TTaskFunction>) && std::is_invocable_r_v<TReturn, std::decay_t<TFunc>&, TArgs...>
+	TTaskFunction(TFunc&& inFunc) {
+		emplace(std::forward<TFunc>(inFunc));
+	}
+
+	TTaskFunction(TTaskFunction&& inOther) noexcept {
+		*this = std::move(inOther);
+	}
+
+	TTaskFunction& operator=(TTaskFunction&& inOther) noexcept {
+		if (this == &inOther) return *this;
+		reset();
+		if (inOther.m_Operations) {
+			inOther.m_Operations->mRelocate(inOther.m_Storage, m_Storage);
+			m_Operations = inOther.m_Operations;
+			inOther.m_Operations = nullptr;
+		}
+		return *this;
+	}
+
+	TTaskFunction& operator=(std::nullptr_t) {
+		reset();
+		return *this;
+	}
+
+	TTaskFunction(const TTaskFunction&) = delete;
+	TTaskFunction& operator=(const TTaskFunction&) = delete;
+
+	~TTaskFunction() {
+		reset();
+	}
+
+	// Constructs the callable directly in place, avoiding the move a temporary would need
+	template <typename TFunc>
+	requires std::is_invocable_r_v<TReturn, std::decay_t<TFunc>&, TArgs...>
+	void emplace(TFunc&& inFunc) {
+		using Func = std::decay_t<TFunc>;
+		static_assert(alignof(Func) <= alignof(std::max_align_t), "Over-aligned callables are not supported by TTaskFunction.");
+
+		reset();
+
+		if constexpr (isInline<Func>) {
+			new (m_Storage) Func(std::forward<TFunc>(inFunc));
+		} else {
+			void* block = STaskAllocator::allocate(sizeof(Func));
+			*reinterpret_cast<Func**>(m_Storage) = new (block) Func(std::forward<TFunc>(inFunc));
+		}
+		m_Operations = &mOperations<Func>;
+	}
+
+	void reset() {
+		if (!m_Operations) return;
+		m_Operations->mDestroy(m_Storage);
+		m_Operations = nullptr;
+	}
+
+	explicit operator bool() const {
+		return m_Operations != nullptr;
+	}
+
+	TReturn operator()(TArgs... inArgs) {
+		return m_Operations->mInvoke(m_Storage, std::forward<TArgs>(inArgs)...);
+	}
+
+private:
+
+	alignas(std::max_align_t) std::byte m_Storage[TInlineSize < sizeof(void*) ? sizeof(void*) : TInlineSize];
+
+	const SOperations* m_Operations = nullptr;
+};
+
+// The task type used by every engine queue
+typedef TTaskFunction<void()> FTask;
@@ -1,21 +1,38 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <ranges>
 #include <thread>
 #include <mutex>
 #include <deque>
 
 #include "basic/Profiling.h"
+#include "basic/core/TaskFunction.h"
+#include "basic/core/WorkStealingQueue.h"
 #include "tracy/TracyC.h"
 
 class CWorker {
 public:
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct STask {
+		FTask mFunction;
+		// When the task was added, used for queue latency
+		Clock::time_point mQueuedTime;
+	};
+
 	std::mutex m_QueueMutex;
 
 	std::condition_variable m_QueueCV;
 
 	std::condition_variable m_FinishedCV;
 
-	std::deque<std::function<void()>> m_Tasks;
+	std::deque<STask> m_Tasks;
 
 	bool m_Stop = false;
 
@@ -24,7 +41,7 @@ public:
 	CWorker() = default;
 
 	bool execute() {
-		std::function<void()> task;
+		STask task;
 		{
 			std::unique_lock lock(m_QueueMutex);
 			m_QueueCV.wait(lock, [this] {
@@ -38,11 +55,7 @@ public:
 			m_Tasks.pop_front();
 		}
 
-		task();
-
-		if (m_Tasks.empty()) {
-			m_FinishedCV.notify_all();
-		}
+		run(task);
 
 		return false;
 	}
@@ -50,24 +63,35 @@ public:
 	//TODO: shouldnt be necessary, but 'main thread' needs it for now
 	void executeAll() {
 		while (getNumberOfTasks() > 0) {
-			std::function<void()> task;
-			{
-				std::unique_lock lock(m_QueueMutex);
-				/*m_QueueCV.wait(lock, [this] {
-					return !m_Tasks.empty() || m_Stop;
-				});*/
-
-				// Get task and remove from tasks
-				task = std::move(m_Tasks.front());
-				m_Tasks.pop_front();
-			}
+			if (!executeNext()) break;
+		}
+	}
 
-			task();
+	// Runs tasks until the deadline, anything left over is carried to the next call
+	// At least one task is always run, so a long task can't stall the queue forever
+	uint32 executeUntil(const Clock::time_point inDeadline) {
+		uint32 executed = 0;
+		do {
+			if (!executeNext()) break;
+			executed++;
+		} while (Clock::now() < inDeadline);
+		return executed;
+	}
 
-			if (m_Tasks.empty()) {
-				m_FinishedCV.notify_all();
-			}
-		}
+	// Moving average of how long tasks sat in the queue before running, in seconds
+	no_discard double getAverageQueueLatency() const {
+		return m_AverageLatency.load(std::memory_order_relaxed);
+	}
+
+	// Longest time a task has sat in the queue since the last reset, in seconds
+	no_discard double getMaxQueueLatency() const {
+		return m_MaxLatency.load(std::memory_order_relaxed);
+	}
+
+	// Should be called from the thread executing tasks
+	void resetQueueLatency() {
+		m_AverageLatency.store(0.0, std::memory_order_relaxed);
+		m_MaxLatency.store(0.0, std::memory_order_relaxed);
 	}
 
 	no_discard int32 getNumberOfTasks() const {
@@ -87,10 +111,10 @@ public:
 		m_QueueCV.notify_all();
 	}
 
-	void add(const std::function<void()>& inFunc) {
+	void add(FTask inFunc) {
 		{
 			std::lock_guard lock(m_QueueMutex);
-			m_Tasks.push_back(std::move(inFunc));
+			m_Tasks.push_back({std::move(inFunc), Clock::now()});
 		}
 		m_QueueCV.notify_all();
 	}
@@ -99,6 +123,42 @@ public:
 		std::unique_lock lock(m_QueueMutex);
 		m_FinishedCV.wait(lock, [this] {return m_Tasks.empty();});
 	}
+
+private:
+
+	// Returns false if there was nothing to run
+	bool executeNext() {
+		STask task;
+		{
+			std::unique_lock lock(m_QueueMutex);
+			if (m_Tasks.empty()) return false;
+
+			// Get task and remove from tasks
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+
+		run(task);
+
+		return true;
+	}
+
+	void run(STask& inTask) {
+		const double latency = std::chrono::duration<double>(Clock::now() - inTask.mQueuedTime).count();
+
+		// Only ever written by the thread executing tasks, so there is no need to CAS
+		m_AverageLatency.store(m_AverageLatency.load(std::memory_order_relaxed) * 0.9 + latency * 0.1, std::memory_order_relaxed);
+		m_MaxLatency.store(std::max(m_MaxLatency.load(std::memory_order_relaxed), latency), std::memory_order_relaxed);
+
+		inTask.mFunction();
+
+		if (m_Tasks.empty()) {
+			m_FinishedCV.notify_all();
+		}
+	}
+
+	std::atomic<double> m_AverageLatency = 0.0;
+	std::atomic<double> m_MaxLatency = 0.0;
 };
 
 class CThread {
@@ -124,8 +184,8 @@ public:
 		return m_Worker;
 	}
 
-	void run(const std::function<void()>& inFunc) {
-		m_Worker.add(inFunc);
+	void run(FTask inFunc) {
+		m_Worker.add(std::move(inFunc));
 	}
 
 	void stop() {
@@ -169,61 +229,288 @@ public:
 		TracyCZoneEnd(ctx); \
 	}
 
+// Decides which lane (and which pool) a task is queued on
+enum class ETaskPriority : uint8 {
+	FRAME, // Work a frame is waiting on, always taken before normal tasks and the only work reserved threads run
+	NORMAL,
+	BACKGROUND // Long running IO and compression, runs on a separate pool so it can't take threads from frame work
+};
+
+/*
+ * Background thread pool with a work stealing deque per thread and lane
+ * Tasks pushed from a pool thread go onto that thread's own deque, so there is no shared lock on the hot path
+ * Tasks pushed from outside of the pool go onto a small injection queue that idle threads drain
+ * Frame tasks are always looked for before normal ones, and the first few threads can be reserved for frame tasks only
+ * Threads are never destroyed after construction, resizing the pool only puts threads to sleep or wakes them up
+ */
 class CThreadPool {
 
-	std::vector<std::thread> m_Threads{};
+	// Allocated from STaskAllocator, so submitting a task doesn't hit the heap
+	struct STask {
+		FTask mFunction;
+		ETaskPriority mPriority;
+		// Called instead of the function if the pool is stopped before the task starts
+		FTask mOnDropped;
+	};
 
-	CWorker m_Worker;
+	// Frame and normal, background tasks use the normal lane of their own pool
+	constexpr static uint32 mNumLanes = 2;
+
+	struct SThreadQueue {
+		TWorkStealingQueue<STask*> mTasks[mNumLanes];
+	};
+
+	// What a thread is currently allowed to run, each role sleeps on its own condition
+	enum class EThreadRole : uint8 {
+		RESERVED, // Frame tasks only
+		GENERAL,
+		INACTIVE // Past the active thread count
+	};
+
+	constexpr static uint32 mNumRoles = 3;
 
 public:
 
-	explicit CThreadPool(const uint32 inNumThreads = std::thread::hardware_concurrency()) {
-		for (uint32 i = 0; i < inNumThreads; ++i) {
-			const std::string name = fmts("Background Thread {}", i);
-			uint32 color = i * (255u / inNumThreads);
-			m_Threads.emplace_back([this, name, color] {
-				TracyCSetThreadName(name.c_str())
-				while (true) {
-					TracyCZone(ctx, 1);
-					TracyCZoneName(ctx, name.c_str(), name.size());
-					TracyCZoneColor(ctx, color);
-					if (m_Worker.execute()) return;
-					TracyCZoneEnd(ctx);
-				}
-			});
-		}
-	}
+	EXPORT explicit CThreadPool(uint32 inNumThreads = std::thread::hardware_concurrency(), const std::string& inName = "Background Thread");
 
 	~CThreadPool() {
 		stop();
 	}
 
+	// The queues are all created before the first thread starts, so this is safe to call from the threads themselves
+	no_discard uint32 getNumberOfThreads() const {
+		return static_cast<uint32>(m_Queues.size());
+	}
+
+	no_discard uint32 getActiveThreads() const {
+		return m_ActiveThreads.load(std::memory_order_acquire);
+	}
+
+	// Always leaves at least one active thread for normal tasks
+	no_discard uint32 getReservedThreads() const {
+		return std::min(m_ReservedThreads.load(std::memory_order_acquire), getActiveThreads() - 1);
+	}
+
+	// Threads past the count finish their current task and go to sleep, clamped between one and the number of threads
+	EXPORT void setActiveThreads(uint32 inNumThreads);
+
+	// The first threads only run frame tasks, so frame work never waits behind a long normal task
+	EXPORT void setReservedThreads(uint32 inNumThreads);
+
+	// Includes tasks that are currently running
+	no_discard int64 getNumberOfTasks() const {
+		return m_PendingTasks.load(std::memory_order_acquire);
+	}
+
+	// Tasks that have been pushed but not yet started
+	no_discard int64 getNumberOfQueuedTasks(const ETaskPriority inPriority) const {
+		return m_QueuedTasks[getLane(inPriority)].load(std::memory_order_acquire);
+	}
+
 	// Whichever thread gets to the task first will run it
-	void run(const std::function<void()>& inFunc) {
-		m_Worker.add(inFunc);
+	// Returns false if the pool has been stopped, neither function is called in that case
+	// If the pool is stopped after the task was queued but before it started, inOnDropped is called instead
+	EXPORT bool run(FTask inFunc, ETaskPriority inPriority = ETaskPriority::NORMAL, FTask inOnDropped = nullptr);
+
+	// Waits until all queued and running tasks have finished
+	EXPORT void wait();
+
+	// Tasks that have not started are dropped, and their drop functions are called on the calling thread
+	EXPORT void stop();
+
+	// Runs a single queued task on the calling thread, returns false if there was nothing to run
+	// Lets a thread that is waiting on other tasks help instead of blocking
+	EXPORT bool tryExecute();
+
+	// If the calling thread is one of this pool's background threads
+	EXPORT bool isPoolThread() const;
+
+private:
+
+	static uint32 getLane(const ETaskPriority inPriority) {
+		return inPriority == ETaskPriority::FRAME ? 0 : 1;
 	}
 
-	void wait() {
-		m_Worker.wait();
+	EThreadRole getRole(uint32 inThreadIndex) const;
+
+	// If there is anything a thread with the given role could run
+	bool hasWork(EThreadRole inRole) const;
+
+	void threadLoop(uint32 inThreadIndex);
+
+	// Goes through the lanes in priority order, own deque first
+	STask* findTask(uint32 inThreadIndex);
+
+	// Injection queue, then steal from other threads starting at a given index
+	STask* findExternalTask(uint32 inLane, uint32 inFirstVictim);
+
+	void execute(STask* inTask);
+
+	// Takes finished or dropped tasks off the pending count, waking anything in wait() once it hits zero
+	void releasePending(int64 inCount);
+
+	// Wakes a sleeping thread that is able to run a task from the lane
+	void wake(uint32 inLane);
+
+	// Lets every sleeping thread recheck its role
+	void wakeAll();
+
+	static void destroyTask(STask* inTask);
+
+	std::string m_Name;
+
+	std::vector<std::thread> m_Threads{};
+
+	std::vector<std::unique_ptr<SThreadQueue>> m_Queues{};
+
+	std::atomic<uint32> m_ActiveThreads = 0;
+
+	std::atomic<uint32> m_ReservedThreads = 0;
+
+	// Tasks from threads that aren't part of the pool
+	std::mutex m_InjectionMutex;
+	std::deque<STask*> m_InjectionQueues[mNumLanes];
+
+	// Idle threads sleep here instead of spinning
+	std::mutex m_SleepMutex;
+	std::condition_variable m_SleepCV[mNumRoles];
+	std::atomic<int32> m_SleepingThreads[mNumRoles] = {};
+
+	std::mutex m_FinishedMutex;
+	std::condition_variable m_FinishedCV;
+
+	// Tasks that have been pushed but not yet taken by a thread
+	std::atomic<int64> m_QueuedTasks[mNumLanes] = {};
+
+	// Tasks that have been pushed but not yet finished
+	std::atomic<int64> m_PendingTasks = 0;
+
+	std::atomic<bool> m_Stop = false;
+
+};
+
+enum class ETaskState : uint8 {
+	WAITING, // Waiting on dependencies
+	QUEUED,
+	RUNNING,
+	FINISHED,
+	CANCELLED
+};
+
+/*
+ * Shared state for a task in the task graph
+ * A task is queued on the thread pool once all of its dependencies have finished
+ * If a dependency is cancelled, everything that depends on it is cancelled as well
+ */
+class CTask : public std::enable_shared_from_this<CTask> {
+
+public:
+
+	explicit CTask(FTask inFunction, const ETaskPriority inPriority = ETaskPriority::NORMAL): m_Function(std::move(inFunction)), m_Priority(inPriority) {}
+
+	no_discard ETaskState getState() const { return m_State.load(std::memory_order_acquire); }
+
+	no_discard ETaskPriority getPriority() const { return m_Priority; }
+
+	// Finished or cancelled
+	no_discard bool isComplete() const {
+		const ETaskState state = getState();
+		return state == ETaskState::FINISHED || state == ETaskState::CANCELLED;
 	}
 
-	void stop() {
-		m_Worker.stop();
-		wait();
-		for (auto& thread : m_Threads) {
-			if (thread.joinable()) thread.join();
-		}
+	EXPORT void wait();
+
+	// Only tasks that have not started running can be cancelled
+	EXPORT bool cancel();
+
+private:
+
+	friend class CThreading;
+
+	// Called once for every dependency (and once when the task is submitted)
+	void release(bool inDependencyCancelled);
+
+	void addContinuation(const std::shared_ptr<CTask>& inTask);
+
+	void execute();
+
+	void complete();
+
+	FTask m_Function;
+
+	ETaskPriority m_Priority;
+
+	std::atomic<ETaskState> m_State = ETaskState::WAITING;
+
+	// Starts at 1 so the task can't be queued while its dependencies are still being added
+	std::atomic<int32> m_RemainingDependencies = 1;
+
+	std::atomic<bool> m_DependencyCancelled = false;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_CompletedCV;
+	bool m_Completed = false;
+
+	// Tasks that depend on this one
+	std::vector<std::shared_ptr<CTask>> m_Continuations;
+};
+
+// Handle to a task, can be copied freely
+class CTaskHandle {
+
+public:
+
+	CTaskHandle() = default;
+
+	explicit CTaskHandle(const std::shared_ptr<CTask>& inTask): m_Task(inTask) {}
+
+	no_discard bool isValid() const { return m_Task != nullptr; }
+
+	no_discard ETaskState getState() const { return m_Task ? m_Task->getState() : ETaskState::FINISHED; }
+
+	no_discard bool isComplete() const { return !m_Task || m_Task->isComplete(); }
+
+	no_discard bool isCancelled() const { return getState() == ETaskState::CANCELLED; }
+
+	// If called from a background thread, other tasks are run while waiting
+	void wait() const {
+		if (m_Task) m_Task->wait();
+	}
+
+	bool cancel() const {
+		return m_Task && m_Task->cancel();
 	}
 
+	// Runs a function after this task has finished, with the same priority
+	inline CTaskHandle then(FTask inFunc) const;
+
+private:
+
+	friend class CThreading;
+
+	std::shared_ptr<CTask> m_Task = nullptr;
 };
 
+// Containers that can be split into index ranges, sstl containers use getSize() instead of size()
+template <typename TContainer>
+concept TParallelContainer = requires(TContainer& inContainer, size_t inIndex) {
+	inContainer.getSize();
+	inContainer[inIndex];
+} || std::ranges::random_access_range<TContainer>;
+
 class CThreading {
 
 public:
 
 	EXPORT static CWorker& getMainThread();
 
-	EXPORT static void runOnBackgroundThread(const std::function<void()>& inFunc);
+	EXPORT static void runOnBackgroundThread(FTask inFunc, ETaskPriority inPriority = ETaskPriority::NORMAL);
+
+	// Runs a function on a background thread once all of its dependencies have finished
+	EXPORT static CTaskHandle runTask(FTask inFunc, const std::vector<CTaskHandle>& inDependencies = {}, ETaskPriority inPriority = ETaskPriority::NORMAL);
+
+	// A task that finishes once all given tasks have finished
+	EXPORT static CTaskHandle whenAll(const std::vector<CTaskHandle>& inTasks);
 
 	// Wait for threads to finish operations
 	EXPORT static void wait();
@@ -231,8 +518,110 @@ public:
 	// Not guaranteed to finish all operations (some may stop prematurely)
 	EXPORT static void stop();
 
+	// Resizes the pools, cheap enough to call every frame since nothing changes unless the counts do
+	EXPORT static void configure(uint32 inWorkerThreads, uint32 inReservedThreads, uint32 inBackgroundThreads);
+
+	// Priority of the task running on the calling thread
+	// Threads outside of the pools (like the main and render threads) are always working on a frame
+	EXPORT static ETaskPriority getCurrentPriority();
+
+	//
+	// Parallel loops
+	// The range is split into chunks of inGrainSize, chunks are handed out to the pool and the calling thread helps
+	// Chunks run at the calling thread's priority, so a loop inside an import stays on the background pool
+	// They return once every chunk has finished, so locals can safely be captured by reference
+	// Grain size should be large enough that a chunk takes a few microseconds, otherwise scheduling costs more than the work
+	//
+
+	// Calls inFunc(chunkBegin, chunkEnd) for every chunk
+	EXPORT static void parallelForRange(size_t inBegin, size_t inEnd, size_t inGrainSize, const std::function<void(size_t, size_t)>& inFunc);
+
+	// Calls inFunc(index) for every index
+	template <typename TFunc>
+	requires std::is_invocable_v<TFunc, size_t>
+	static void parallelFor(const size_t inBegin, const size_t inEnd, const size_t inGrainSize, TFunc&& inFunc) {
+		parallelForRange(inBegin, inEnd, inGrainSize, [&inFunc](const size_t inChunkBegin, const size_t inChunkEnd) {
+			for (size_t i = inChunkBegin; i < inChunkEnd; ++i) {
+				inFunc(i);
+			}
+		});
+	}
+
+	// Calls inFunc(element) for every element, works for TVector, TList, THierarchy children and random access std containers
+	template <typename TContainer, typename TFunc>
+	requires TParallelContainer<TContainer>
+	static void parallelFor(TContainer& inContainer, const size_t inGrainSize, TFunc&& inFunc) {
+		parallelFor(0, getContainerSize(inContainer), inGrainSize, [&](const size_t inIndex) {
+			inFunc(getContainerElement(inContainer, inIndex));
+		});
+	}
+
+	// Reduces inMap(index) with inReduce, chunks are combined in order so the result is deterministic
+	// inIdentity must not change the result when reduced with any value (0 for sums, max float for min etc.)
+	template <typename TType, typename TMapFunc, typename TReduceFunc>
+	requires std::is_invocable_r_v<TType, TMapFunc, size_t> and std::is_invocable_r_v<TType, TReduceFunc, TType, TType>
+	static TType parallelReduce(const size_t inBegin, const size_t inEnd, const size_t inGrainSize, const TType& inIdentity, TMapFunc&& inMap, TReduceFunc&& inReduce) {
+		if (inEnd <= inBegin) return inIdentity;
+
+		const size_t grainSize = std::max<size_t>(inGrainSize, 1);
+		std::vector<TType> partials((inEnd - inBegin + grainSize - 1) / grainSize, inIdentity);
+
+		parallelForRange(inBegin, inEnd, grainSize, [&](const size_t inChunkBegin, const size_t inChunkEnd) {
+			TType value = inIdentity;
+			for (size_t i = inChunkBegin; i < inChunkEnd; ++i) {
+				value = inReduce(value, inMap(i));
+			}
+			partials[(inChunkBegin - inBegin) / grainSize] = value;
+		});
+
+		TType result = inIdentity;
+		for (const auto& partial : partials) {
+			result = inReduce(result, partial);
+		}
+		return result;
+	}
+
+	// Reduces inMap(element) for every element in a container
+	template <typename TType, typename TContainer, typename TMapFunc, typename TReduceFunc>
+	requires TParallelContainer<TContainer>
+	static TType parallelReduce(TContainer& inContainer, const size_t inGrainSize, const TType& inIdentity, TMapFunc&& inMap, TReduceFunc&& inReduce) {
+		return parallelReduce(0, getContainerSize(inContainer), inGrainSize, inIdentity, [&](const size_t inIndex) -> TType {
+			return inMap(getContainerElement(inContainer, inIndex));
+		}, inReduce);
+	}
+
+	// The pool that runs tasks of the given priority
+	EXPORT static CThreadPool& getThreadPool(ETaskPriority inPriority = ETaskPriority::NORMAL);
+
 	CWorker mMainThread;
 
 	// Modern computers can reliably have > 4 cores ( 8 threads)
 	CThreadPool mThreadPool{std::thread::hardware_concurrency()};
+
+	// Sized the same so every thread can be used when nothing else is running, configure decides how many are awake
+	CThreadPool mBackgroundPool{std::thread::hardware_concurrency(), "IO Thread"};
+
+private:
+
+	template <typename TContainer>
+	static size_t getContainerSize(const TContainer& inContainer) {
+		if constexpr (requires { inContainer.getSize(); }) {
+			return inContainer.getSize();
+		} else {
+			return std::ranges::size(inContainer);
+		}
+	}
+
+	template <typename TContainer>
+	static decltype(auto) getContainerElement(TContainer& inContainer, const size_t inIndex) {
+		if constexpr (requires { inContainer.getSize(); }) {
+			return inContainer[inIndex];
+		} else {
+			return std::ranges::begin(inContainer)[inIndex];
+		}
+	}
 };
+
+CTaskHandle CTaskHandle::then(FTask inFunc) const {
+	return CThreading::runTask(std::move(inFunc), {*this}, m_Task ? m_Task->getPriority() : ETaskPriority::NORMAL);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "basic/core/Common.h"
+
+/*
+ * Lock-free work stealing deque (Chase-Lev)
+ * The owning thread pushes and pops from the bottom, any other thread can steal from the top
+ * Only trivially copyable types are allowed, since elements can be read by a stealer that then loses the race
+ * https://www.dre.vanderbilt.edu/~schmidt/PDF/work-stealing-dequeue.pdf
+ */
+
+template <typename TType>
+requires std::is_trivially_copyable_v<TType>
+class TWorkStealingQueue {
+
+	struct SRing {
+
+		explicit SRing(const int64 inCapacity)
+		: mCapacity(inCapacity),
+		mMask(inCapacity - 1),
+		mData(std::make_unique<std::atomic<TType>[]>(inCapacity)) {}
+
+		no_discard TType get(const int64 inIndex) const {
+			return mData[inIndex & mMask].load(std::memory_order_relaxed);
+		}
+
+		void put(const int64 inIndex, TType inValue) {
+			mData[inIndex & mMask].store(inValue, std::memory_order_relaxed);
+		}
+
+		const int64 mCapacity;
+		const int64 mMask;
+		std::unique_ptr<std::atomic<TType>[]> mData;
+	};
+
+public:
+
+	// Capacity must be a power of two so indices can be masked
+	explicit TWorkStealingQueue(const int64 inCapacity = 1024) {
+		asts((inCapacity & (inCapacity - 1)) == 0, "Work stealing queue capacity {} is not a power of two.", inCapacity);
+		m_Rings.push_back(std::make_unique<SRing>(inCapacity));
+		m_Ring.store(m_Rings.back().get(), std::memory_order_relaxed);
+	}
+
+	TWorkStealingQueue(const TWorkStealingQueue&) = delete;
+	TWorkStealingQueue& operator=(const TWorkStealingQueue&) = delete;
+
+	no_discard bool isEmpty() const {
+		return getSize() <= 0;
+	}
+
+	// Not exact if other threads are modifying the queue
+	no_discard int64 getSize() const {
+		const int64 bottom = m_Bottom.load(std::memory_order_relaxed);
+		const int64 top = m_Top.load(std::memory_order_relaxed);
+		return bottom - top;
+	}
+
+	// Owner only
+	void push(TType inValue) {
+		const int64 bottom = m_Bottom.load(std::memory_order_relaxed);
+		const int64 top = m_Top.load(std::memory_order_acquire);
+		SRing* ring = m_Ring.load(std::memory_order_relaxed);
+
+		if (bottom - top > ring->mCapacity - 1) {
+			ring = grow(ring, bottom, top);
+		}
+
+		ring->put(bottom, inValue);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	// Owner only, takes the most recently pushed element
+	bool pop(TType& outValue) {
+		const int64 bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		SRing* ring = m_Ring.load(std::memory_order_relaxed);
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64 top = m_Top.load(std::memory_order_relaxed);
+
+		// Queue was already empty
+		if (top > bottom) {
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		outValue = ring->get(bottom);
+
+		// More than one element left, so no stealer can reach this one
+		if (top < bottom) {
+			return true;
+		}
+
+		// Last element, race any stealers for it
+		const bool won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	// Any thread, takes the oldest element
+	bool steal(TType& outValue) {
+		int64 top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64 bottom = m_Bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom) {
+			return false;
+		}
+
+		const TType value = m_Ring.load(std::memory_order_acquire)->get(top);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return false;
+		}
+
+		outValue = value;
+		return true;
+	}
+
+private:
+
+	// Old rings are kept alive until destruction, since a stealer may still be reading from them
+	SRing* grow(const SRing* inRing, const int64 inBottom, const int64 inTop) {
+		m_Rings.push_back(std::make_unique<SRing>(inRing->mCapacity * 2));
+		SRing* ring = m_Rings.back().get();
+		for (int64 i = inTop; i < inBottom; ++i) {
+			ring->put(i, inRing->get(i));
+		}
+		m_Ring.store(ring, std::memory_order_release);
+		return ring;
+	}
+
+	// Top and bottom are written by different threads, so keep them on separate cache lines
+	alignas(64) std::atomic<int64> m_Top = 0;
+	alignas(64) std::atomic<int64> m_Bottom = 0;
+	alignas(64) std::atomic<SRing*> m_Ring = nullptr;
+
+	std::vector<std::unique_ptr<SRing>> m_Rings;
+};
@@ -0,0 +1,330 @@
+#include "basic/core/ChunkArchive.h"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+
+#include "basic/core/Threading.h"
+#include "common/tracy_lz4.hpp"
+
+// Smaller chunks aren't worth a task, or the size prefix
+constexpr static size_t gMinCompressedSize = 256;
+
+// Compression has to save at least an eighth, otherwise the chunk is stored as is and can be used straight from the mapping
+constexpr static size_t gMinSavedFraction = 8;
+
+// CRC32 (the zlib polynomial), eight bytes at a time
+// Each table folds one more byte through the polynomial, so eight lookups replace eight dependent steps
+static const std::array<std::array<uint32, 256>, 8> gCrcTables = [] {
+	std::array<std::array<uint32, 256>, 8> tables{};
+	for (uint32 i = 0; i < 256; ++i) {
+		uint32 crc = i;
+		for (int32 bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+		tables[0][i] = crc;
+	}
+	for (uint32 i = 0; i < 256; ++i) {
+		for (size_t table = 1; table < 8; ++table) {
+			tables[table][i] = (tables[table - 1][i] >> 8) ^ tables[0][tables[table - 1][i] & 0xff];
+		}
+	}
+	return tables;
+}();
+
+uint32 getChecksum(const std::span<const uint8> inData) {
+	const uint8* data = inData.data();
+	size_t size = inData.size();
+	uint32 crc = 0xffffffffu;
+
+	while (size >= 8) {
+		uint32 low, high;
+		memcpy(&low, data, 4);
+		memcpy(&high, data + 4, 4);
+		low ^= crc;
+		crc = gCrcTables[7][low & 0xff] ^ gCrcTables[6][(low >> 8) & 0xff] ^ gCrcTables[5][(low >> 16) & 0xff] ^ gCrcTables[4][low >> 24] ^
+			gCrcTables[3][high & 0xff] ^ gCrcTables[2][(high >> 8) & 0xff] ^ gCrcTables[1][(high >> 16) & 0xff] ^ gCrcTables[0][high >> 24];
+		data += 8;
+		size -= 8;
+	}
+
+	while (size-- > 0) {
+		crc = (crc >> 8) ^ gCrcTables[0][(crc ^ *data++) & 0xff];
+	}
+
+	return ~crc;
+}
+
+static size_t alignChunk(const size_t inOffset) {
+	return (inOffset + gChunkAlignment - 1) & ~(gChunkAlignment - 1);
+}
+
+static bool shouldCompress(const size_t inSize) {
+	return inSize >= gMinCompressedSize && inSize <= LZ4_MAX_INPUT_SIZE;
+}
+
+// The uncompressed size followed by the block, or nothing if it didn't shrink enough
+static std::vector<uint8> compressChunk(const std::span<const uint8> inData) {
+	const int32 bound = tracy::LZ4_compressBound(static_cast<int32>(inData.size()));
+	std::vector<uint8> compressed(sizeof(uint64) + bound);
+
+	const uint64 rawSize = inData.size();
+	memcpy(compressed.data(), &rawSize, sizeof(uint64));
+
+	const int32 size = tracy::LZ4_compress_default(reinterpret_cast<const char*>(inData.data()), reinterpret_cast<char*>(compressed.data() + sizeof(uint64)), static_cast<int32>(inData.size()), bound);
+	if (size <= 0 || sizeof(uint64) + size > inData.size() - inData.size() / gMinSavedFraction) {
+		return {};
+	}
+
+	compressed.resize(sizeof(uint64) + size);
+	return compressed;
+}
+
+std::vector<uint8> CChunkWriter::finish() const {
+	// The class table is only complete once every chunk has been written, so it goes last
+	CMemoryArchive classTable;
+	if (!m_ClassTable.empty()) {
+		classTable << m_ClassTable;
+	}
+
+	// The chunks are independent, so they are all compressed at once
+	std::vector<std::vector<uint8>> compressed(m_Chunks.size());
+	if (m_Compress) {
+		std::vector<size_t> compressible;
+		for (size_t i = 0; i < m_Chunks.size(); ++i) {
+			if (shouldCompress(m_Chunks[i].mData.getSize())) {
+				compressible.push_back(i);
+			}
+		}
+
+		CThreading::parallelFor(compressible, 1, [&](const size_t inIndex) {
+			compressed[inIndex] = compressChunk(m_Chunks[inIndex].mData.getData());
+		});
+	}
+
+	std::vector<std::span<const uint8>> chunkData;
+	std::vector<SChunkEntry> entries;
+	chunkData.reserve(m_Chunks.size() + 1);
+	entries.reserve(m_Chunks.size() + 1);
+
+	// Lay the chunks out first, so the buffer is allocated once
+	size_t offset = alignChunk(sizeof(SChunkFileHeader));
+	auto addEntry = [&](const uint32 inType, const uint32 inVersion, const std::span<const uint8> inData, const EChunkFlags inFlags) {
+		chunkData.push_back(inData);
+		entries.push_back({
+			.mType = inType,
+			.mVersion = inVersion,
+			.mOffset = offset,
+			.mSize = inData.size(),
+			.mChecksum = getChecksum(inData),
+			.mFlags = static_cast<uint32>(inFlags)
+		});
+		offset = alignChunk(offset + inData.size());
+	};
+
+	for (size_t i = 0; i < m_Chunks.size(); ++i) {
+		if (!compressed[i].empty()) {
+			addEntry(m_Chunks[i].mType, m_Chunks[i].mVersion, compressed[i], EChunkFlags::LZ4);
+		} else {
+			addEntry(m_Chunks[i].mType, m_Chunks[i].mVersion, m_Chunks[i].mData.getData(), EChunkFlags::NONE);
+		}
+	}
+	if (!m_ClassTable.empty()) {
+		addEntry(gClassTableChunk, 1, classTable.getData(), EChunkFlags::NONE);
+	}
+
+	const SChunkFileHeader header{
+		.mChunkCount = static_cast<uint32>(entries.size()),
+		.mTableOffset = offset
+	};
+
+	// Padding stays zeroed, so the same chunks always produce the same file
+	std::vector<uint8> file(offset + entries.size() * sizeof(SChunkEntry), 0);
+	memcpy(file.data(), &header, sizeof(SChunkFileHeader));
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (!chunkData[i].empty()) {
+			memcpy(file.data() + entries[i].mOffset, chunkData[i].data(), chunkData[i].size());
+		}
+	}
+	if (!entries.empty()) {
+		memcpy(file.data() + offset, entries.data(), entries.size() * sizeof(SChunkEntry));
+	}
+
+	return file;
+}
+
+bool writeFileAtomic(const std::string& inFilePath, const std::span<const uint8> inData) {
+	// Written next to the target and renamed over it, so a crash or full disk mid-save leaves the old file intact
+	const std::string tempPath = inFilePath + ".tmp";
+	{
+		CFileArchive file(tempPath, "wb");
+		if (!file.isOpen()) return false;
+		file.writeSpan(inData.data(), inData.size());
+	}
+
+	std::error_code error;
+	if (std::filesystem::file_size(tempPath, error) != inData.size() || error) {
+		msgs("Could not write {}, the previous file was kept.", inFilePath);
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, inFilePath, error);
+	if (error) {
+		msgs("Could not replace {}: {}", inFilePath, error.message());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool CChunkWriter::writeToFile(const std::string& inFilePath) const {
+	return writeFileAtomic(inFilePath, finish());
+}
+
+CChunkReader::CChunkReader(const std::string& inFilePath)
+	: m_File(inFilePath) {
+
+	if (!m_File.isOpen() || m_File.getSize() < sizeof(SChunkFileHeader)) return;
+
+	const std::span<const uint8> file = m_File.getData();
+
+	SChunkFileHeader header;
+	memcpy(&header, file.data(), sizeof(SChunkFileHeader));
+	if (header.mMagic != SChunkFileHeader::mExpectedMagic) return;
+
+	// Past this point a broken file is still a chunk file, it just has no chunks to read
+	m_IsChunkFile = true;
+
+	if (header.mVersion > SChunkFileHeader::mCurrentVersion) {
+		msgs("Chunk file {} is version {}, only up to {} is supported.", inFilePath, header.mVersion, SChunkFileHeader::mCurrentVersion);
+		return;
+	}
+
+	if (header.mTableOffset > file.size() || header.mChunkCount > (file.size() - header.mTableOffset) / sizeof(SChunkEntry)) {
+		msgs("Chunk file {} has a table of contents outside of the file.", inFilePath);
+		return;
+	}
+
+	m_Entries.resize(header.mChunkCount);
+	if (header.mChunkCount > 0) {
+		memcpy(m_Entries.data(), file.data() + header.mTableOffset, header.mChunkCount * sizeof(SChunkEntry));
+	}
+
+	// Checked once here, so readers can trust the offsets
+	for (const auto& entry : m_Entries) {
+		if (entry.mOffset > header.mTableOffset || entry.mSize > header.mTableOffset - entry.mOffset) {
+			msgs("Chunk {:08x} in {} is outside of the file.", entry.mType, inFilePath);
+			m_Entries.clear();
+			return;
+		}
+	}
+
+	m_Decompressed.resize(m_Entries.size());
+
+	// Read before anything else, so every chunk after it can use it
+	// Version 1 files stored class names inline, so they are read without one
+	if (header.mVersion >= 2) {
+		if (has(gClassTableChunk) && !read(gClassTableChunk, m_ClassTable)) {
+			m_Entries.clear();
+			return;
+		}
+		m_File.setClassTable(&m_ClassTable);
+	}
+}
+
+const SChunkEntry* CChunkReader::find(const uint32 inType) const {
+	for (const auto& entry : m_Entries) {
+		if (entry.mType == inType) return &entry;
+	}
+	return nullptr;
+}
+
+bool CChunkReader::verify(const SChunkEntry& inEntry) const {
+	const std::span<const uint8> data = m_File.getData().subspan(inEntry.mOffset, inEntry.mSize);
+	if (getChecksum(data) != inEntry.mChecksum) {
+		msgs("Chunk {:08x} failed its checksum, it will be skipped.", inEntry.mType);
+		return false;
+	}
+	return true;
+}
+
+bool CChunkReader::decompress(const size_t inIndex) {
+	const SChunkEntry& entry = m_Entries[inIndex];
+	CMemoryArchive& archive = m_Decompressed[inIndex];
+	if (archive.getSize() > 0) return true;
+
+	if (!verify(entry)) return false;
+
+	const std::span<const uint8> stored = m_File.getData().subspan(entry.mOffset, entry.mSize);
+	uint64 rawSize = 0;
+	if (stored.size() >= sizeof(uint64)) {
+		memcpy(&rawSize, stored.data(), sizeof(uint64));
+	}
+	if (rawSize == 0 || rawSize > LZ4_MAX_INPUT_SIZE) {
+		msgs("Chunk {:08x} has a broken compression header, it will be skipped.", entry.mType);
+		return false;
+	}
+
+	std::vector<uint8> data(rawSize);
+	const int32 size = tracy::LZ4_decompress_safe(reinterpret_cast<const char*>(stored.data() + sizeof(uint64)), reinterpret_cast<char*>(data.data()), static_cast<int32>(stored.size() - sizeof(uint64)), static_cast<int32>(rawSize));
+	if (size != static_cast<int32>(rawSize)) {
+		msgs("Chunk {:08x} failed to decompress, it will be skipped.", entry.mType);
+		return false;
+	}
+
+	archive = CMemoryArchive(std::move(data));
+	return true;
+}
+
+void CChunkReader::decompressAll() {
+	std::vector<size_t> compressed;
+	for (size_t i = 0; i < m_Entries.size(); ++i) {
+		if (m_Entries[i].isCompressed() && m_Decompressed[i].getSize() == 0) {
+			compressed.push_back(i);
+		}
+	}
+
+	// Each chunk has its own buffer, so they can all be decompressed at once
+	CThreading::parallelFor(compressed, 1, [this](const size_t inIndex) {
+		decompress(inIndex);
+	});
+}
+
+CArchive* CChunkReader::openChunk(const uint32 inType) {
+	const SChunkEntry* entry = find(inType);
+	if (!entry) return nullptr;
+
+	if (entry->isCompressed()) {
+		const size_t index = entry - m_Entries.data();
+		if (!decompress(index)) return nullptr;
+
+		m_OpenChunk = &m_Decompressed[index];
+		m_OpenChunk->rewind();
+		m_OpenChunk->setClassTable(m_File.getClassTable());
+		m_ChunkEnd = m_OpenChunk->getSize();
+		return m_OpenChunk;
+	}
+
+	if (!verify(*entry)) return nullptr;
+
+	m_OpenChunk = nullptr;
+	m_File.seek(entry->mOffset);
+	m_ChunkEnd = entry->mOffset + entry->mSize;
+	return &m_File;
+}
+
+std::span<const uint8> CChunkReader::getChunkData(const uint32 inType) {
+	const SChunkEntry* entry = find(inType);
+	if (!entry) return {};
+
+	if (entry->isCompressed()) {
+		const size_t index = entry - m_Entries.data();
+		if (!decompress(index)) return {};
+		return m_Decompressed[index].getData();
+	}
+
+	if (!verify(*entry)) return {};
+
+	return m_File.getData().subspan(entry->mOffset, entry->mSize);
+}
@@ -0,0 +1,37 @@
+#include "basic/core/DerivedDataCache.h"
+
+#include "basic/core/Paths.h"
+
+std::filesystem::path CDerivedDataCache::getEntryPath(const SHash& inKey) {
+	// Created on first use, the cache directory itself is made by SPaths
+	static const std::filesystem::path directory = [] {
+		std::filesystem::path path = SPaths::get()->mCachePath;
+		path.append("DerivedData");
+		std::error_code error;
+		std::filesystem::create_directories(path, error);
+		return path;
+	}();
+
+	return directory / (inKey.toString() + ".ddc");
+}
+
+CDerivedDataCache::SStats CDerivedDataCache::getStats() {
+	const TShared<CDerivedDataCache> cache = get();
+	return {
+		.mHits = cache->m_Hits,
+		.mMisses = cache->m_Misses,
+		.mBytesRead = cache->m_BytesRead,
+		.mBytesWritten = cache->m_BytesWritten
+	};
+}
+
+void CDerivedDataCache::recordLookup(const bool inHit, const size_t inSize) {
+	if (inHit) {
+		m_Hits++;
+		m_BytesRead += inSize;
+	} else {
+		m_Misses++;
+	}
+
+	msgs("Derived data cache {} ({} hits, {} misses)", inHit ? "hit" : "miss", m_Hits.load(), m_Misses.load());
+}
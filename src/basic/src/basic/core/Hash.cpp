@@ -0,0 +1,131 @@
+#include "basic/core/Hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+// FIPS 180-4
+constexpr static std::array<uint32, 64> gRoundConstants = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static uint32 rotateRight(const uint32 inValue, const uint32 inBits) {
+	return (inValue >> inBits) | (inValue << (32 - inBits));
+}
+
+std::string SHash::toString() const {
+	constexpr static char digits[] = "0123456789abcdef";
+
+	std::string string(mBytes.size() * 2, '0');
+	for (size_t i = 0; i < mBytes.size(); ++i) {
+		string[i * 2] = digits[mBytes[i] >> 4];
+		string[i * 2 + 1] = digits[mBytes[i] & 0xf];
+	}
+	return string;
+}
+
+CHasher::CHasher()
+	: m_State{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {}
+
+void CHasher::update(const std::span<const uint8> inData) {
+	if (inData.empty()) return;
+
+	const uint8* data = inData.data();
+	size_t size = inData.size();
+	m_TotalSize += size;
+
+	// Top up a partial block first
+	if (m_BlockSize > 0) {
+		const size_t count = std::min(size, m_Block.size() - m_BlockSize);
+		memcpy(m_Block.data() + m_BlockSize, data, count);
+		m_BlockSize += count;
+		data += count;
+		size -= count;
+
+		if (m_BlockSize < m_Block.size()) return;
+		compress(m_Block.data());
+		m_BlockSize = 0;
+	}
+
+	// Whole blocks go straight from the input
+	for (; size >= m_Block.size(); data += m_Block.size(), size -= m_Block.size()) {
+		compress(data);
+	}
+
+	memcpy(m_Block.data(), data, size);
+	m_BlockSize = size;
+}
+
+SHash CHasher::finish() {
+	const uint64 totalBits = m_TotalSize * 8;
+
+	// A one bit, zeros up to 56 bytes into a block, then the length in bits as big endian
+	m_Block[m_BlockSize++] = 0x80;
+	if (m_BlockSize > 56) {
+		memset(m_Block.data() + m_BlockSize, 0, m_Block.size() - m_BlockSize);
+		compress(m_Block.data());
+		m_BlockSize = 0;
+	}
+	memset(m_Block.data() + m_BlockSize, 0, 56 - m_BlockSize);
+	for (size_t i = 0; i < 8; ++i) {
+		m_Block[56 + i] = static_cast<uint8>(totalBits >> (56 - i * 8));
+	}
+	compress(m_Block.data());
+
+	SHash hash;
+	for (size_t i = 0; i < m_State.size(); ++i) {
+		hash.mBytes[i * 4] = static_cast<uint8>(m_State[i] >> 24);
+		hash.mBytes[i * 4 + 1] = static_cast<uint8>(m_State[i] >> 16);
+		hash.mBytes[i * 4 + 2] = static_cast<uint8>(m_State[i] >> 8);
+		hash.mBytes[i * 4 + 3] = static_cast<uint8>(m_State[i]);
+	}
+	return hash;
+}
+
+void CHasher::compress(const uint8* inBlock) {
+	std::array<uint32, 64> schedule;
+	for (size_t i = 0; i < 16; ++i) {
+		schedule[i] = static_cast<uint32>(inBlock[i * 4]) << 24 | static_cast<uint32>(inBlock[i * 4 + 1]) << 16 | static_cast<uint32>(inBlock[i * 4 + 2]) << 8 | static_cast<uint32>(inBlock[i * 4 + 3]);
+	}
+	for (size_t i = 16; i < 64; ++i) {
+		const uint32 s0 = rotateRight(schedule[i - 15], 7) ^ rotateRight(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+		const uint32 s1 = rotateRight(schedule[i - 2], 17) ^ rotateRight(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+		schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+	}
+
+	uint32 a = m_State[0], b = m_State[1], c = m_State[2], d = m_State[3];
+	uint32 e = m_State[4], f = m_State[5], g = m_State[6], h = m_State[7];
+
+	for (size_t i = 0; i < 64; ++i) {
+		const uint32 s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+		const uint32 choice = (e & f) ^ (~e & g);
+		const uint32 temp1 = h + s1 + choice + gRoundConstants[i] + schedule[i];
+		const uint32 s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+		const uint32 majority = (a & b) ^ (a & c) ^ (b & c);
+		const uint32 temp2 = s0 + majority;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	m_State[0] += a;
+	m_State[1] += b;
+	m_State[2] += c;
+	m_State[3] += d;
+	m_State[4] += e;
+	m_State[5] += f;
+	m_State[6] += g;
+	m_State[7] += h;
+}
@@ -0,0 +1,86 @@
+#include "basic/core/MappedArchive.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedArchive::CMappedArchive(const std::string& inFilePath) {
+#ifdef _WIN32
+	const HANDLE file = CreateFileA(inFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size)) {
+		m_IsOpen = true;
+
+		// Empty files can't be mapped, but are still valid
+		if (size.QuadPart > 0) {
+			if (const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+				// The view keeps the mapping alive on its own
+				m_Data = static_cast<const uint8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				CloseHandle(mapping);
+			}
+			m_IsOpen = m_Data != nullptr;
+			m_Size = m_IsOpen ? static_cast<size_t>(size.QuadPart) : 0;
+		}
+	}
+
+	CloseHandle(file);
+#else
+	const int file = open(inFilePath.c_str(), O_RDONLY);
+	if (file < 0) return;
+
+	struct stat status;
+	if (fstat(file, &status) == 0) {
+		m_IsOpen = true;
+
+		if (status.st_size > 0) {
+			void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (data != MAP_FAILED) {
+				// Assets are almost always read front to back
+				madvise(data, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+				m_Data = static_cast<const uint8*>(data);
+				m_Size = static_cast<size_t>(status.st_size);
+			} else {
+				m_IsOpen = false;
+			}
+		}
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	::close(file);
+#endif
+}
+
+std::span<const uint8> CMappedArchive::view(const size_t inSize) {
+	asts(isOpen(), "Reading from a mapped file that isn't open.");
+	asts(inSize <= m_Size - m_Position, "Reading {} bytes at {} past the end of a mapped file of {} bytes.", inSize, m_Position, m_Size);
+
+	const std::span<const uint8> bytes{m_Data + m_Position, inSize};
+	m_Position += inSize;
+	return bytes;
+}
+
+void CMappedArchive::close() {
+	if (!m_IsOpen) return;
+
+	if (m_Data) {
+#ifdef _WIN32
+		UnmapViewOfFile(m_Data);
+#else
+		munmap(const_cast<uint8*>(m_Data), m_Size);
+#endif
+	}
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Position = 0;
+	m_IsOpen = false;
+}
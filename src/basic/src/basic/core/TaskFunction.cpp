@@ -0,0 +1,123 @@
+#include "basic/core/TaskFunction.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Every block size is a multiple of the strictest fundamental alignment
+constexpr static size_t gBlockSizes[] = {128, 256, STaskAllocator::mMaxBlockSize};
+constexpr static size_t gNumBlockSizes = std::size(gBlockSizes);
+
+// How many blocks move between a thread and the shared pool at once
+constexpr static uint32 gBatchSize = 64;
+
+struct SFreeBlock {
+	SFreeBlock* mNext;
+};
+
+// Blocks freed on threads that never allocate (like a consumer thread) are handed back here
+struct SSharedPool {
+	std::mutex mMutex;
+	SFreeBlock* mFree[gNumBlockSizes] = {};
+	// Blocks are never returned to the heap, the pool only grows to the peak number of large tasks in flight
+	std::vector<std::unique_ptr<std::byte[]>> mSlabs;
+};
+
+struct SThreadPool {
+	SFreeBlock* mFree[gNumBlockSizes] = {};
+	uint32 mCount[gNumBlockSizes] = {};
+};
+
+// Never destroyed, tasks can still be freed by global thread pools during static destruction
+static SSharedPool& getSharedPool() {
+	static SSharedPool* pool = new SSharedPool();
+	return *pool;
+}
+
+static thread_local SThreadPool gThreadPool;
+
+static size_t getSizeIndex(const size_t inSize) {
+	for (size_t i = 0; i < gNumBlockSizes; ++i) {
+		if (inSize <= gBlockSizes[i]) return i;
+	}
+	return gNumBlockSizes;
+}
+
+// Refills the calling thread's free list, from the shared pool if it has blocks, otherwise with a new slab
+static void refill(const size_t inIndex) {
+	SSharedPool& shared = getSharedPool();
+	std::lock_guard lock(shared.mMutex);
+
+	uint32 count = 0;
+	SFreeBlock* first = shared.mFree[inIndex];
+	SFreeBlock* last = nullptr;
+	for (SFreeBlock* block = first; block && count < gBatchSize; block = block->mNext) {
+		last = block;
+		count++;
+	}
+
+	if (last) {
+		shared.mFree[inIndex] = last->mNext;
+		last->mNext = gThreadPool.mFree[inIndex];
+		gThreadPool.mFree[inIndex] = first;
+		gThreadPool.mCount[inIndex] += count;
+		return;
+	}
+
+	const size_t blockSize = gBlockSizes[inIndex];
+	auto& slab = shared.mSlabs.emplace_back(std::make_unique<std::byte[]>(blockSize * gBatchSize));
+	for (uint32 i = 0; i < gBatchSize; ++i) {
+		const auto block = reinterpret_cast<SFreeBlock*>(slab.get() + i * blockSize);
+		block->mNext = gThreadPool.mFree[inIndex];
+		gThreadPool.mFree[inIndex] = block;
+	}
+	gThreadPool.mCount[inIndex] += gBatchSize;
+}
+
+// Hands a batch back to the shared pool so a thread that only frees doesn't hoard blocks
+static void spill(const size_t inIndex) {
+	SFreeBlock* first = gThreadPool.mFree[inIndex];
+	SFreeBlock* last = first;
+	for (uint32 i = 1; i < gBatchSize; ++i) {
+		last = last->mNext;
+	}
+	gThreadPool.mFree[inIndex] = last->mNext;
+	gThreadPool.mCount[inIndex] -= gBatchSize;
+
+	SSharedPool& shared = getSharedPool();
+	std::lock_guard lock(shared.mMutex);
+	last->mNext = shared.mFree[inIndex];
+	shared.mFree[inIndex] = first;
+}
+
+void* STaskAllocator::allocate(const size_t inSize) {
+	const size_t index = getSizeIndex(inSize);
+	if (index == gNumBlockSizes) {
+		return ::operator new(inSize);
+	}
+
+	if (!gThreadPool.mFree[index]) {
+		refill(index);
+	}
+
+	SFreeBlock* block = gThreadPool.mFree[index];
+	gThreadPool.mFree[index] = block->mNext;
+	gThreadPool.mCount[index]--;
+	return block;
+}
+
+void STaskAllocator::deallocate(void* inBlock, const size_t inSize) {
+	const size_t index = getSizeIndex(inSize);
+	if (index == gNumBlockSizes) {
+		::operator delete(inBlock);
+		return;
+	}
+
+	const auto block = static_cast<SFreeBlock*>(inBlock);
+	block->mNext = gThreadPool.mFree[index];
+	gThreadPool.mFree[index] = block;
+
+	if (++gThreadPool.mCount[index] > gBatchSize * 2) {
+		spill(index);
+	}
+}
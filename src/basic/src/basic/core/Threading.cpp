@@ -2,16 +2,508 @@
 
 CThreading gThreading;
 
+// The pool (and index in that pool) that the current thread belongs to, if any
+static thread_local CThreadPool* gCurrentPool = nullptr;
+static thread_local uint32 gCurrentThreadIndex = 0;
+
+// Priority of the pool task the current thread is running
+static thread_local ETaskPriority gCurrentPriority = ETaskPriority::FRAME;
+
+// How many times an idle thread looks for work before going to sleep
+constexpr static uint32 gIdleSpinCount = 64;
+
+CThreadPool::CThreadPool(const uint32 inNumThreads, const std::string& inName)
+: m_Name(inName) {
+	const uint32 numThreads = std::max(inNumThreads, 1u);
+	m_ActiveThreads.store(numThreads, std::memory_order_release);
+
+	// Queues need to exist before any thread can try to steal from them
+	for (uint32 i = 0; i < numThreads; ++i) {
+		m_Queues.push_back(std::make_unique<SThreadQueue>());
+	}
+
+	for (uint32 i = 0; i < numThreads; ++i) {
+		m_Threads.emplace_back([this, i] {
+			threadLoop(i);
+		});
+	}
+}
+
+void CThreadPool::setActiveThreads(const uint32 inNumThreads) {
+	const uint32 numThreads = std::clamp(inNumThreads, 1u, getNumberOfThreads());
+	if (m_ActiveThreads.exchange(numThreads, std::memory_order_acq_rel) != numThreads) {
+		wakeAll();
+	}
+}
+
+void CThreadPool::setReservedThreads(const uint32 inNumThreads) {
+	if (m_ReservedThreads.exchange(inNumThreads, std::memory_order_acq_rel) != inNumThreads) {
+		wakeAll();
+	}
+}
+
+bool CThreadPool::run(FTask inFunc, const ETaskPriority inPriority, FTask inOnDropped) {
+	if (m_Stop.load(std::memory_order_acquire)) return false;
+
+	const uint32 lane = getLane(inPriority);
+	const auto task = new (STaskAllocator::allocate(sizeof(STask))) STask{std::move(inFunc), inPriority, std::move(inOnDropped)};
+
+	// Counted before the task is visible, so a thread that takes it can never push the count below zero
+	m_PendingTasks.fetch_add(1, std::memory_order_acq_rel);
+	m_QueuedTasks[lane].fetch_add(1, std::memory_order_seq_cst);
+
+	// Pool threads push to their own deque, anything else goes through the injection queue
+	// Pool threads are joined before stop drains the deques, so only the injection queue can race it
+	if (gCurrentPool == this) {
+		m_Queues[gCurrentThreadIndex]->mTasks[lane].push(task);
+	} else {
+		std::unique_lock lock(m_InjectionMutex);
+		// Stop may have taken the injection queues since the check above, nothing would ever run the task
+		if (m_Stop.load(std::memory_order_acquire)) {
+			lock.unlock();
+			m_QueuedTasks[lane].fetch_sub(1, std::memory_order_acq_rel);
+			destroyTask(task);
+			releasePending(1);
+			return false;
+		}
+		m_InjectionQueues[lane].push_back(task);
+	}
+
+	wake(lane);
+
+	return true;
+}
+
+void CThreadPool::wait() {
+	std::unique_lock lock(m_FinishedMutex);
+	m_FinishedCV.wait(lock, [this] {
+		return m_PendingTasks.load(std::memory_order_acquire) <= 0;
+	});
+}
+
+void CThreadPool::stop() {
+	if (m_Stop.exchange(true, std::memory_order_acq_rel)) return;
+
+	wakeAll();
+
+	for (auto& thread : m_Threads) {
+		if (thread.joinable()) thread.join();
+	}
+
+	// Anything pushed from outside of the pool after this sees the stop flag under the lock and is never queued
+	std::deque<STask*> injected[mNumLanes];
+	{
+		std::lock_guard lock(m_InjectionMutex);
+		for (uint32 lane = 0; lane < mNumLanes; ++lane) {
+			injected[lane].swap(m_InjectionQueues[lane]);
+		}
+	}
+
+	// Collect any tasks that never started
+	std::vector<STask*> dropped;
+	for (uint32 lane = 0; lane < mNumLanes; ++lane) {
+		const size_t firstDropped = dropped.size();
+		STask* task;
+		for (const auto& queue : m_Queues) {
+			while (queue->mTasks[lane].steal(task)) {
+				dropped.push_back(task);
+			}
+		}
+		dropped.insert(dropped.end(), injected[lane].begin(), injected[lane].end());
+
+		m_QueuedTasks[lane].fetch_sub(static_cast<int64>(dropped.size() - firstDropped), std::memory_order_acq_rel);
+	}
+
+	// Dropped tasks still have to tell whoever is waiting on them, otherwise a task handle or parallel for would wait forever
+	// Called outside of any lock, the drop function may try to run more work, which the stopped pool refuses
+	for (const auto task : dropped) {
+		if (task->mOnDropped) {
+			task->mOnDropped();
+		}
+		destroyTask(task);
+	}
+
+	releasePending(static_cast<int64>(dropped.size()));
+}
+
+CThreadPool::EThreadRole CThreadPool::getRole(const uint32 inThreadIndex) const {
+	if (inThreadIndex >= getActiveThreads()) return EThreadRole::INACTIVE;
+	if (inThreadIndex < getReservedThreads()) return EThreadRole::RESERVED;
+	return EThreadRole::GENERAL;
+}
+
+bool CThreadPool::hasWork(const EThreadRole inRole) const {
+	switch (inRole) {
+		case EThreadRole::RESERVED:
+			return m_QueuedTasks[getLane(ETaskPriority::FRAME)].load(std::memory_order_seq_cst) > 0;
+		case EThreadRole::GENERAL:
+			return m_QueuedTasks[getLane(ETaskPriority::FRAME)].load(std::memory_order_seq_cst) > 0
+				|| m_QueuedTasks[getLane(ETaskPriority::NORMAL)].load(std::memory_order_seq_cst) > 0;
+		default:
+			return false;
+	}
+}
+
+void CThreadPool::threadLoop(const uint32 inThreadIndex) {
+	gCurrentPool = this;
+	gCurrentThreadIndex = inThreadIndex;
+
+	const std::string name = fmts("{} {}", m_Name, inThreadIndex);
+	const uint32 color = inThreadIndex * (255u / getNumberOfThreads());
+	TracyCSetThreadName(name.c_str())
+
+	while (!m_Stop.load(std::memory_order_acquire)) {
+		const EThreadRole role = getRole(inThreadIndex);
+
+		STask* task = nullptr;
+		for (uint32 spin = 0; spin < gIdleSpinCount && !task && role != EThreadRole::INACTIVE; ++spin) {
+			if (m_Stop.load(std::memory_order_acquire)) return;
+			task = findTask(inThreadIndex);
+			if (!task) std::this_thread::yield();
+		}
+
+		if (task) {
+			TracyCZone(ctx, 1);
+			TracyCZoneName(ctx, name.c_str(), name.size());
+			TracyCZoneColor(ctx, color);
+			execute(task);
+			TracyCZoneEnd(ctx);
+			continue;
+		}
+
+		// Nothing this thread is allowed to run, so sleep until a task is pushed or the role changes
+		const uint8 roleIndex = static_cast<uint8>(role);
+		std::unique_lock lock(m_SleepMutex);
+		m_SleepingThreads[roleIndex].fetch_add(1, std::memory_order_seq_cst);
+		m_SleepCV[roleIndex].wait(lock, [this, role, inThreadIndex] {
+			return m_Stop.load(std::memory_order_acquire) || getRole(inThreadIndex) != role || hasWork(role);
+		});
+		m_SleepingThreads[roleIndex].fetch_sub(1, std::memory_order_seq_cst);
+	}
+}
+
+CThreadPool::STask* CThreadPool::findTask(const uint32 inThreadIndex) {
+	// Reserved threads only look at frame tasks, a thread that was just deactivated can still help while it finishes
+	const uint32 numLanes = getRole(inThreadIndex) == EThreadRole::RESERVED ? 1 : mNumLanes;
+
+	STask* task = nullptr;
+	for (uint32 lane = 0; lane < numLanes; ++lane) {
+		// Newest task from our own deque is most likely to still be in cache
+		if (m_Queues[inThreadIndex]->mTasks[lane].pop(task)) {
+			m_QueuedTasks[lane].fetch_sub(1, std::memory_order_acq_rel);
+			return task;
+		}
+
+		// Start at our neighbour so threads don't all hit the same victim
+		if ((task = findExternalTask(lane, inThreadIndex + 1))) {
+			return task;
+		}
+	}
+
+	return nullptr;
+}
+
+CThreadPool::STask* CThreadPool::findExternalTask(const uint32 inLane, const uint32 inFirstVictim) {
+	if (m_QueuedTasks[inLane].load(std::memory_order_acquire) <= 0) return nullptr;
+
+	STask* task = nullptr;
+
+	// Tasks from outside the pool
+	{
+		std::lock_guard lock(m_InjectionMutex);
+		if (auto& injectionQueue = m_InjectionQueues[inLane]; !injectionQueue.empty()) {
+			task = injectionQueue.front();
+			injectionQueue.pop_front();
+			m_QueuedTasks[inLane].fetch_sub(1, std::memory_order_acq_rel);
+			return task;
+		}
+	}
+
+	// Steal the oldest task from another thread
+	const uint32 numQueues = static_cast<uint32>(m_Queues.size());
+	for (uint32 i = 0; i < numQueues; ++i) {
+		const uint32 victim = (inFirstVictim + i) % numQueues;
+		if (gCurrentPool == this && victim == gCurrentThreadIndex) continue;
+		if (m_Queues[victim]->mTasks[inLane].steal(task)) {
+			m_QueuedTasks[inLane].fetch_sub(1, std::memory_order_acq_rel);
+			return task;
+		}
+	}
+
+	return nullptr;
+}
+
+bool CThreadPool::tryExecute() {
+	STask* task = nullptr;
+	if (isPoolThread()) {
+		task = findTask(gCurrentThreadIndex);
+	} else {
+		for (uint32 lane = 0; lane < mNumLanes && !task; ++lane) {
+			task = findExternalTask(lane, 0);
+		}
+	}
+	if (!task) return false;
+	execute(task);
+	return true;
+}
+
+bool CThreadPool::isPoolThread() const {
+	return gCurrentPool == this;
+}
+
+void CThreadPool::execute(STask* inTask) {
+	// Tasks can run inside of other tasks while waiting, so put the outer priority back afterwards
+	const ETaskPriority previousPriority = gCurrentPriority;
+	gCurrentPriority = inTask->mPriority;
+
+	inTask->mFunction();
+	destroyTask(inTask);
+
+	gCurrentPriority = previousPriority;
+
+	releasePending(1);
+}
+
+void CThreadPool::releasePending(const int64 inCount) {
+	if (inCount <= 0) return;
+	if (m_PendingTasks.fetch_sub(inCount, std::memory_order_acq_rel) == inCount) {
+		{
+			std::lock_guard lock(m_FinishedMutex);
+		}
+		m_FinishedCV.notify_all();
+	}
+}
+
+void CThreadPool::wake(const uint32 inLane) {
+	const auto tryWake = [this](const EThreadRole inRole) {
+		const uint8 roleIndex = static_cast<uint8>(inRole);
+		// Only pay for the wake up if someone is actually asleep
+		if (m_SleepingThreads[roleIndex].load(std::memory_order_seq_cst) <= 0) return false;
+		{
+			std::lock_guard lock(m_SleepMutex);
+		}
+		m_SleepCV[roleIndex].notify_one();
+		return true;
+	};
+
+	// Reserved threads exist for frame tasks, so they get woken first
+	if (inLane == getLane(ETaskPriority::FRAME) && tryWake(EThreadRole::RESERVED)) return;
+	tryWake(EThreadRole::GENERAL);
+}
+
+void CThreadPool::wakeAll() {
+	{
+		std::lock_guard lock(m_SleepMutex);
+	}
+	for (auto& sleepCV : m_SleepCV) {
+		sleepCV.notify_all();
+	}
+}
+
+void CThreadPool::destroyTask(STask* inTask) {
+	inTask->~STask();
+	STaskAllocator::deallocate(inTask, sizeof(STask));
+}
+
 CWorker& CThreading::getMainThread() { return gThreading.mMainThread; }
 
-void CThreading::runOnBackgroundThread(const std::function<void()>& inFunc) {
-	gThreading.mThreadPool.run(inFunc);
+void CThreading::runOnBackgroundThread(FTask inFunc, const ETaskPriority inPriority) {
+	getThreadPool(inPriority).run(std::move(inFunc), inPriority);
 }
 
 void CThreading::wait() {
 	gThreading.mThreadPool.wait();
+	gThreading.mBackgroundPool.wait();
 }
 
 void CThreading::stop() {
 	gThreading.mThreadPool.stop();
-}
\ No newline at end of file
+	gThreading.mBackgroundPool.stop();
+}
+
+void CThreading::configure(const uint32 inWorkerThreads, const uint32 inReservedThreads, const uint32 inBackgroundThreads) {
+	gThreading.mThreadPool.setActiveThreads(inWorkerThreads);
+	gThreading.mThreadPool.setReservedThreads(inReservedThreads);
+	gThreading.mBackgroundPool.setActiveThreads(inBackgroundThreads);
+}
+
+ETaskPriority CThreading::getCurrentPriority() {
+	if (gCurrentPool == &gThreading.mBackgroundPool) return ETaskPriority::BACKGROUND;
+	if (gCurrentPool == &gThreading.mThreadPool) return gCurrentPriority;
+	return ETaskPriority::FRAME;
+}
+
+void CTask::wait() {
+	// Background threads help run tasks instead of blocking a thread the pool is counting on
+	if (CThreadPool* pool = gCurrentPool) {
+		while (!isComplete()) {
+			if (!pool->tryExecute()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	std::unique_lock lock(m_Mutex);
+	m_CompletedCV.wait(lock, [this] {
+		return m_Completed;
+	});
+}
+
+bool CTask::cancel() {
+	ETaskState state = m_State.load(std::memory_order_acquire);
+	while (state == ETaskState::WAITING || state == ETaskState::QUEUED) {
+		if (m_State.compare_exchange_weak(state, ETaskState::CANCELLED, std::memory_order_acq_rel)) {
+			complete();
+			return true;
+		}
+	}
+	return false;
+}
+
+void CTask::release(const bool inDependencyCancelled) {
+	if (inDependencyCancelled) {
+		m_DependencyCancelled.store(true, std::memory_order_release);
+	}
+
+	if (m_RemainingDependencies.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+	if (m_DependencyCancelled.load(std::memory_order_acquire)) {
+		cancel();
+		return;
+	}
+
+	// May have been cancelled while waiting
+	if (ETaskState expected = ETaskState::WAITING; m_State.compare_exchange_strong(expected, ETaskState::QUEUED, std::memory_order_acq_rel)) {
+		// Tasks without a function (like whenAll) only exist to join dependencies, so there is no need to queue them
+		if (!m_Function) {
+			execute();
+			return;
+		}
+
+		// A stopped pool never runs the task, cancelling it still completes it, so waits and continuations don't hang
+		const bool queued = CThreading::getThreadPool(m_Priority).run([task = shared_from_this()] {
+			task->execute();
+		}, m_Priority, [task = shared_from_this()] {
+			task->cancel();
+		});
+		if (!queued) {
+			cancel();
+		}
+	}
+}
+
+void CTask::addContinuation(const std::shared_ptr<CTask>& inTask) {
+	{
+		std::lock_guard lock(m_Mutex);
+		if (!m_Completed) {
+			m_Continuations.push_back(inTask);
+			return;
+		}
+	}
+	inTask->release(getState() == ETaskState::CANCELLED);
+}
+
+void CTask::execute() {
+	// Cancelled after being queued
+	if (ETaskState expected = ETaskState::QUEUED; !m_State.compare_exchange_strong(expected, ETaskState::RUNNING, std::memory_order_acq_rel)) {
+		return;
+	}
+
+	if (m_Function) {
+		m_Function();
+	}
+
+	m_State.store(ETaskState::FINISHED, std::memory_order_release);
+	complete();
+}
+
+void CTask::complete() {
+	std::vector<std::shared_ptr<CTask>> continuations;
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Completed = true;
+		continuations.swap(m_Continuations);
+	}
+	m_CompletedCV.notify_all();
+
+	// The function may hold references to things that should be freed as soon as possible
+	m_Function = nullptr;
+
+	const bool cancelled = getState() == ETaskState::CANCELLED;
+	for (const auto& continuation : continuations) {
+		continuation->release(cancelled);
+	}
+}
+
+void CThreading::parallelForRange(const size_t inBegin, const size_t inEnd, const size_t inGrainSize, const std::function<void(size_t, size_t)>& inFunc) {
+	if (inEnd <= inBegin) return;
+
+	const size_t grainSize = std::max<size_t>(inGrainSize, 1);
+	const size_t numChunks = (inEnd - inBegin + grainSize - 1) / grainSize;
+
+	// Not worth going wide
+	if (numChunks == 1) {
+		inFunc(inBegin, inEnd);
+		return;
+	}
+
+	// Chunks are handed out dynamically, so a slow chunk doesn't hold up the rest of a thread's share
+	std::atomic<size_t> nextChunk = 0;
+	std::atomic<uint32> finishedHelpers = 0;
+
+	const auto work = [&] {
+		for (size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < numChunks; chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) {
+			const size_t chunkBegin = inBegin + chunk * grainSize;
+			inFunc(chunkBegin, std::min(chunkBegin + grainSize, inEnd));
+		}
+	};
+
+	const ETaskPriority priority = getCurrentPriority();
+	CThreadPool& pool = getThreadPool(priority);
+
+	// The calling thread counts as one of the workers
+	const uint32 numHelpers = static_cast<uint32>(std::min<size_t>(numChunks - 1, pool.getActiveThreads()));
+	uint32 queuedHelpers = 0;
+	for (uint32 i = 0; i < numHelpers; ++i) {
+		// A helper the pool drops on stop never runs, it still has to count as finished or the wait below never ends
+		const bool queued = pool.run([&] {
+			work();
+			finishedHelpers.fetch_add(1, std::memory_order_release);
+		}, priority, [&] {
+			finishedHelpers.fetch_add(1, std::memory_order_release);
+		});
+		if (queued) queuedHelpers++;
+	}
+
+	work();
+
+	// Helpers reference this stack frame, so they all need to be done before returning
+	while (finishedHelpers.load(std::memory_order_acquire) < queuedHelpers) {
+		if (!pool.tryExecute()) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+CThreadPool& CThreading::getThreadPool(const ETaskPriority inPriority) {
+	return inPriority == ETaskPriority::BACKGROUND ? gThreading.mBackgroundPool : gThreading.mThreadPool;
+}
+
+CTaskHandle CThreading::runTask(FTask inFunc, const std::vector<CTaskHandle>& inDependencies, const ETaskPriority inPriority) {
+	const auto task = std::make_shared<CTask>(std::move(inFunc), inPriority);
+
+	for (const auto& dependency : inDependencies) {
+		if (!dependency.isValid()) continue;
+		task->m_RemainingDependencies.fetch_add(1, std::memory_order_acq_rel);
+		dependency.m_Task->addContinuation(task);
+	}
+
+	// Release the submission reference, queues the task if every dependency is already done
+	task->release(false);
+
+	return CTaskHandle{task};
+}
+
+CTaskHandle CThreading::whenAll(const std::vector<CTaskHandle>& inTasks) {
+	return runTask(nullptr, inTasks);
+}
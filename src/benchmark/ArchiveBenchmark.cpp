@@ -0,0 +1,195 @@
+#include <cstring>
+#include <filesystem>
+
+#include "Benchmark.h"
+#include "basic/core/Archive.h"
+#include "basic/core/ChunkArchive.h"
+#include "basic/core/MappedArchive.h"
+#include "basic/core/MemoryArchive.h"
+#include "basic/core/Paths.h"
+#include "rendercore/EngineLoader.h"
+#include "rendercore/Font.h"
+
+// Keeps everything in memory and counts the virtual calls, so only the archive's own overhead is measured
+class CCountingArchive final : public CArchive {
+
+public:
+
+	void rewind() {
+		m_ReadPosition = 0;
+		mCalls = 0;
+	}
+
+	std::vector<uint8> mData;
+
+	uint64 mCalls = 0;
+
+protected:
+
+	virtual void write(const void* inValue, const size_t inElementSize, const size_t inCount) override {
+		mCalls++;
+		const auto bytes = static_cast<const uint8*>(inValue);
+		mData.insert(mData.end(), bytes, bytes + inElementSize * inCount);
+	}
+
+	virtual void read(void* inValue, const size_t inElementSize, const size_t inCount) override {
+		mCalls++;
+		memcpy(inValue, mData.data() + m_ReadPosition, inElementSize * inCount);
+		m_ReadPosition += inElementSize * inCount;
+	}
+
+private:
+
+	size_t m_ReadPosition = 0;
+};
+
+// Loads an asset from disk, then round trips it through memory
+// The bytes written have to match the file, since the bulk path must not change the format
+template <typename TType>
+static void benchmarkAsset(const std::string& inFileName, const bool inExactBytes) {
+	const std::filesystem::path path = std::filesystem::path(SPaths::get()->mAssetPath.string()) / inFileName;
+	const std::vector<uint8> fileData = CFileArchive(path.string(), "rb").readFile<uint8>();
+	asts(!fileData.empty(), "Could not read {}.", path.string());
+
+	const double megabytes = fileData.size() / (1024.0 * 1024.0);
+
+	TType value;
+	const double fileSeconds = timeFunction([&] {
+		CFileArchive file(path.string(), "rb");
+		file >> value;
+	});
+
+	const double mappedSeconds = bestTime(5, [&] {
+		CMappedArchive file(path.string());
+		TType loaded;
+		file >> loaded;
+	});
+
+	CCountingArchive archive;
+	const double saveSeconds = bestTime(5, [&] {
+		archive.mData.clear();
+		archive.rewind();
+		archive << value;
+	});
+	const uint64 saveCalls = archive.mCalls;
+
+	if (inExactBytes) {
+		asts(archive.mData == fileData, "{} serialized differently than the file on disk.", inFileName);
+	} else {
+		asts(archive.mData.size() == fileData.size(), "{} serialized to {} bytes, the file has {}.", inFileName, archive.mData.size(), fileData.size());
+	}
+
+	// Both go through the write buffer, the memory archive just writes the whole thing once at the end
+	const std::string savePath = (std::filesystem::temp_directory_path() / inFileName).string();
+	const double fileSaveSeconds = bestTime(5, [&] {
+		CFileArchive file(savePath, "wb");
+		file << value;
+	});
+	const double bufferedSaveSeconds = bestTime(5, [&] {
+		CMemoryArchive memory;
+		memory << value;
+		memory.writeToFile(savePath);
+	});
+	std::filesystem::remove(savePath);
+
+	uint64 loadCalls = 0;
+	const double loadSeconds = bestTime(5, [&] {
+		archive.rewind();
+		TType loaded;
+		archive >> loaded;
+		loadCalls = archive.mCalls;
+	});
+
+	msgs("{} ({:.2f} MB)", inFileName, megabytes);
+	msgs("  file load:   {:>10.1f} MB/s", megabytes / fileSeconds);
+	msgs("  mapped load: {:>10.1f} MB/s", megabytes / mappedSeconds);
+	msgs("  file save:   {:>10.1f} MB/s", megabytes / fileSaveSeconds);
+	msgs("  memory file: {:>10.1f} MB/s", megabytes / bufferedSaveSeconds);
+	msgs("  memory save: {:>10.1f} MB/s, {} writes", megabytes / saveSeconds, saveCalls);
+	msgs("  memory load: {:>10.1f} MB/s, {} reads", megabytes / loadSeconds, loadCalls);
+}
+
+// Font files are the font followed by its atlas
+struct SFontFile {
+	SFont mFont;
+	std::vector<uint8> mAtlas;
+
+	friend CArchive& operator<<(CArchive& inArchive, const SFontFile& inFile) {
+		inArchive << inFile.mFont;
+		inArchive << inFile.mAtlas;
+		return inArchive;
+	}
+
+	friend CArchive& operator>>(CArchive& inArchive, SFontFile& inFile) {
+		inArchive >> inFile.mFont;
+		inArchive >> inFile.mAtlas;
+		return inArchive;
+	}
+};
+
+// The atlas is around a megabyte, which used to be a virtual call per byte
+ADD_BENCHMARK(ArchiveFont) {
+	// Letters are in an unordered map, so only the size is guaranteed to match
+	benchmarkAsset<SFontFile>("segoeui.fnt", false);
+}
+
+ADD_BENCHMARK(ArchiveMesh) {
+	benchmarkAsset<SMeshData>("Sphere.msh", true);
+}
+
+// Whole file sizes after LZ4, against the vertices and indices as they sit on the gpu
+ADD_BENCHMARK(MeshEncoding) {
+	const std::string path = (std::filesystem::path(SPaths::get()->mAssetPath.string()) / "Sphere.msh").string();
+
+	SMeshData mesh;
+	{
+		CChunkReader reader(path);
+		asts(reader.isOpen(), "Could not read {}.", path);
+		if (reader.isChunkFile()) {
+			asts(mesh.loadChunks(reader), "{} is missing chunks.", path);
+		} else {
+			reader.getArchive() >> mesh;
+		}
+	}
+
+	const size_t rawSize = mesh.vertices.size() * sizeof(SVertex) + mesh.indices.size() * sizeof(uint32);
+	const double megabytes = rawSize / (1024.0 * 1024.0);
+
+	CMemoryArchive stream;
+	stream << mesh;
+
+	msgs("Sphere.msh ({} vertices, {} indices, {:.2f} MB on the gpu)", mesh.vertices.size(), mesh.indices.size(), megabytes);
+	msgs("  plain stream: {:>10} bytes", stream.getSize());
+
+	const std::string savePath = (std::filesystem::temp_directory_path() / "Sphere.msh").string();
+	auto benchmarkEncoding = [&](const char* inName, const SMeshData::EVertexEncoding inEncoding) {
+		CChunkWriter writer;
+		mesh.saveChunks(writer, inEncoding);
+		const size_t fileSize = writer.finish().size();
+		writer.writeToFile(savePath);
+
+		SMeshData loaded;
+		const double loadSeconds = bestTime(5, [&] {
+			CChunkReader reader(savePath);
+			loaded = {};
+			asts(loaded.loadChunks(reader), "{} mesh did not load back.", inName);
+		});
+
+		asts(loaded.indices == mesh.indices, "{} mesh changed its indices.", inName);
+
+		float maxError = 0.f;
+		for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+			maxError = std::max(maxError, glm::length(loaded.vertices[i].position - mesh.vertices[i].position));
+		}
+		if (inEncoding == SMeshData::EVertexEncoding::LOSSLESS) {
+			asts(memcmp(loaded.vertices.data(), mesh.vertices.data(), mesh.vertices.size() * sizeof(SVertex)) == 0, "Lossless mesh changed its vertices.");
+		}
+
+		msgs("  {:<12}  {:>10} bytes, {:.1f}x smaller, {:>8.1f} MB/s load, {:.6f} max position error", inName, fileSize, static_cast<double>(rawSize) / fileSize, megabytes / loadSeconds, maxError);
+	};
+
+	benchmarkEncoding("lossless:", SMeshData::EVertexEncoding::LOSSLESS);
+	benchmarkEncoding("quantized:", SMeshData::EVertexEncoding::QUANTIZED);
+
+	std::filesystem::remove(savePath);
+}
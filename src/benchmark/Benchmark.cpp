@@ -0,0 +1,44 @@
+#include "Benchmark.h"
+
+#include <cstdlib>
+#include <new>
+
+// Per thread, so pool threads starting up or finishing other work don't show up in a benchmark's count
+static thread_local uint64 gAllocations = 0;
+
+// Every heap allocation made by this executable goes through here, so benchmarks can count them
+void* operator new(const size_t inSize) {
+	gAllocations++;
+	if (void* memory = std::malloc(inSize ? inSize : 1)) return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* inMemory) noexcept {
+	std::free(inMemory);
+}
+
+void operator delete(void* inMemory, size_t) noexcept {
+	std::free(inMemory);
+}
+
+uint64 SBenchmark::getAllocations() {
+	return gAllocations;
+}
+
+std::vector<std::pair<std::string, SBenchmark::FBenchmark*>>& SBenchmark::getBenchmarks() {
+	static std::vector<std::pair<std::string, FBenchmark*>> benchmarks;
+	return benchmarks;
+}
+
+// Runs every benchmark, or only the ones whose name contains the first argument
+int main(const int argc, char** argv) {
+	const std::string filter = argc > 1 ? argv[1] : "";
+
+	for (const auto& [name, function] : SBenchmark::getBenchmarks()) {
+		if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+		msgs("--- {} ---", name);
+		function();
+	}
+
+	return 0;
+}
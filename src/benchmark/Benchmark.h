@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "basic/core/Common.h"
+
+/*
+ * Tiny benchmark harness, each benchmark file registers its own benchmarks statically
+ * Results are printed to the console, there is no pass or fail unless a benchmark checks its own results
+ */
+
+struct SBenchmark {
+
+	typedef void FBenchmark();
+
+	static std::vector<std::pair<std::string, FBenchmark*>>& getBenchmarks();
+
+	// Number of heap allocations made by the calling thread so far, only counts allocations made with operator new (and on windows, only from this executable)
+	static uint64 getAllocations();
+
+	static int addBenchmark(const std::string& inName, FBenchmark* inFunction) {
+		getBenchmarks().emplace_back(inName, inFunction);
+		return 0;
+	}
+};
+
+#define ADD_BENCHMARK(name) \
+	static void name(); \
+	static int CONCAT(__benchmark_, name) = SBenchmark::addBenchmark(#name, &name); \
+	static void name()
+
+// Returns the time a function took in seconds
+template <typename TFunc>
+double timeFunction(TFunc&& inFunc) {
+	const auto start = std::chrono::high_resolution_clock::now();
+	inFunc();
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Runs a function a number of times and returns the best time, which is the least affected by noise
+template <typename TFunc>
+double bestTime(const uint32 inRepeats, TFunc&& inFunc) {
+	double best = std::numeric_limits<double>::max();
+	for (uint32 i = 0; i < inRepeats; ++i) {
+		best = std::min(best, timeFunction(inFunc));
+	}
+	return best;
+}
@@ -0,0 +1,61 @@
+#include <atomic>
+#include <thread>
+
+#include "Benchmark.h"
+#include "basic/core/CommandQueue.h"
+
+// Many producers hammering one consumer, checks every command ran exactly once and in order per producer
+ADD_BENCHMARK(CommandQueueMultipleProducers) {
+	constexpr uint32 numCommands = 200000;
+
+	struct SContext {
+		uint64 mExecuted = 0;
+		uint64 mSum = 0;
+		std::vector<uint32> mLastValue;
+	};
+
+	const uint32 maxProducers = std::max(std::thread::hardware_concurrency(), 2u) * 2;
+	for (uint32 numProducers = 1; numProducers <= maxProducers; numProducers *= 2) {
+		const uint32 commandsPerProducer = numCommands / numProducers;
+
+		TCommandQueue<void(SContext&), 1024> queue;
+		SContext ctx;
+		ctx.mLastValue.resize(numProducers, 0);
+
+		const double seconds = timeFunction([&] {
+			std::vector<std::thread> producers;
+			for (uint32 producer = 0; producer < numProducers; ++producer) {
+				producers.emplace_back([&queue, producer, commandsPerProducer] {
+					for (uint32 value = 1; value <= commandsPerProducer; ++value) {
+						const auto command = [producer, value](SContext& inContext) {
+							asts(inContext.mLastValue[producer] + 1 == value, "Producer {} command {} ran out of order.", producer, value);
+							inContext.mLastValue[producer] = value;
+							inContext.mSum += value;
+							inContext.mExecuted++;
+						};
+						while (!queue.push(command)) {
+							std::this_thread::yield();
+						}
+					}
+				});
+			}
+
+			const uint64 expected = static_cast<uint64>(commandsPerProducer) * numProducers;
+			while (ctx.mExecuted < expected) {
+				if (queue.executeAll(ctx) == 0) {
+					std::this_thread::yield();
+				}
+			}
+
+			for (auto& thread : producers) {
+				thread.join();
+			}
+		});
+
+		const uint64 expectedSum = static_cast<uint64>(commandsPerProducer) * (commandsPerProducer + 1) / 2 * numProducers;
+		asts(ctx.mSum == expectedSum, "Command queue lost commands, sum was {} instead of {}.", ctx.mSum, expectedSum);
+		asts(queue.isEmpty(), "Command queue still has {} commands.", queue.getSize());
+
+		msgs("{:>3} producers: {:>12.0f} commands/s", numProducers, ctx.mExecuted / seconds);
+	}
+}
@@ -0,0 +1,285 @@
+#include "Benchmark.h"
+#include "basic/core/MemoryArchive.h"
+#include "rendercore/EngineLoader.h"
+#include "rendercore/Font.h"
+#include "scene/base/Scene.h"
+
+/*
+ * Round trips through a memory archive, so only serialization is measured and not the disk
+ * Every case checks that what it loads matches what it saved, so a change to Archive.h that breaks the format fails here too
+ * Allocations only count this executable, anything allocated inside the engine's dlls on windows is not included
+ */
+
+// Saves and loads in a loop and reports the best of each, plus the allocations one save and one load make
+template <typename TSave, typename TLoad>
+static void benchmarkRoundTrip(const std::string& inName, const size_t inObjects, TSave&& inSave, TLoad&& inLoad) {
+	CMemoryArchive archive;
+
+	// Once up front, so the buffer has grown before anything is timed
+	inSave(archive);
+	const double megabytes = archive.getSize() / (1024.0 * 1024.0);
+
+	const double saveSeconds = bestTime(5, [&] {
+		archive.clear();
+		inSave(archive);
+	});
+
+	archive.clear();
+	uint64 allocations = SBenchmark::getAllocations();
+	inSave(archive);
+	const uint64 saveAllocations = SBenchmark::getAllocations() - allocations;
+
+	const double loadSeconds = bestTime(5, [&] {
+		archive.rewind();
+		inLoad(archive);
+	});
+
+	archive.rewind();
+	allocations = SBenchmark::getAllocations();
+	inLoad(archive);
+	const uint64 loadAllocations = SBenchmark::getAllocations() - allocations;
+
+	asts(archive.getPosition() == archive.getSize(), "{} loaded {} of {} bytes.", inName, archive.getPosition(), archive.getSize());
+
+	msgs("{:<22} {:>9.2f} MB, {:>9.1f} MB/s save, {:>9.1f} MB/s load, {:>6.2f} / {:>6.2f} allocations per object",
+		inName, megabytes, megabytes / saveSeconds, megabytes / loadSeconds,
+		static_cast<double>(saveAllocations) / inObjects, static_cast<double>(loadAllocations) / inObjects);
+}
+
+ADD_BENCHMARK(SerializeScalars) {
+	constexpr size_t numValues = 1000000;
+
+	benchmarkRoundTrip("scalars", numValues * 4, [&](CArchive& inArchive) {
+		for (size_t i = 0; i < numValues; ++i) {
+			inArchive << static_cast<int32>(i);
+			inArchive << static_cast<float>(i);
+			inArchive << static_cast<uint64>(i);
+			inArchive << (i % 2 == 0);
+		}
+	}, [&](CArchive& inArchive) {
+		for (size_t i = 0; i < numValues; ++i) {
+			int32 integer;
+			float decimal;
+			uint64 large;
+			bool boolean;
+			inArchive >> integer >> decimal >> large >> boolean;
+			asts(integer == static_cast<int32>(i) && large == i && boolean == (i % 2 == 0), "Scalar {} did not round trip.", i);
+		}
+	});
+}
+
+static std::vector<SVertex> makeVertices(const size_t inCount) {
+	std::vector<SVertex> vertices(inCount);
+	for (size_t i = 0; i < inCount; ++i) {
+		vertices[i].position = Vector3f{static_cast<float>(i), static_cast<float>(i % 7), static_cast<float>(i % 13)};
+		vertices[i].normal = Vector3f{0.f, 1.f, 0.f};
+		vertices[i].setUV(static_cast<float>(i % 100) / 100.f, 0.5f);
+	}
+	return vertices;
+}
+
+ADD_BENCHMARK(SerializeVertices) {
+	const std::vector<SVertex> vertices = makeVertices(1000000);
+
+	benchmarkRoundTrip("std::vector<SVertex>", vertices.size(), [&](CArchive& inArchive) {
+		inArchive << vertices;
+	}, [&](CArchive& inArchive) {
+		std::vector<SVertex> loaded;
+		inArchive >> loaded;
+		asts(loaded.size() == vertices.size() && memcmp(loaded.data(), vertices.data(), vertices.size() * sizeof(SVertex)) == 0, "Vertices did not round trip.");
+	});
+}
+
+// A grid, so indices span every size the plain stream splits them into
+ADD_BENCHMARK(SerializeMeshData) {
+	constexpr uint32 gridSize = 512;
+
+	SMeshData mesh;
+	mesh.vertices = makeVertices(gridSize * gridSize);
+	for (uint32 y = 0; y + 1 < gridSize; ++y) {
+		for (uint32 x = 0; x + 1 < gridSize; ++x) {
+			const uint32 corner = y * gridSize + x;
+			mesh.indices.insert(mesh.indices.end(), {corner, corner + 1, corner + gridSize, corner + 1, corner + gridSize + 1, corner + gridSize});
+		}
+	}
+	mesh.surfaces.push_back({.name = "Grid", .startIndex = 0, .count = static_cast<uint32>(mesh.indices.size())});
+
+	benchmarkRoundTrip("SMeshData", mesh.vertices.size(), [&](CArchive& inArchive) {
+		inArchive << mesh;
+	}, [&](CArchive& inArchive) {
+		SMeshData loaded;
+		inArchive >> loaded;
+		asts(loaded.indices == mesh.indices && loaded.vertices.size() == mesh.vertices.size(), "Mesh did not round trip.");
+	});
+}
+
+// Small objects with a string and a map, so this is mostly per call overhead
+ADD_BENCHMARK(SerializeFont) {
+	constexpr size_t numFonts = 1000;
+
+	SFont font;
+	font.mName = "Benchmark Font";
+	font.mAtlasSize = Extent32u{1024, 1024};
+	font.mSize = 128;
+	for (uint8 character = 32; character < 127; ++character) {
+		font.letters.emplace(character, SFont::Letter{.mUV0 = Vector2f{character / 128.f}, .mUV1 = Vector2f{(character + 1) / 128.f}, .mBearing = {character, character}, .mAdvance = character});
+	}
+
+	benchmarkRoundTrip("SFont", numFonts, [&](CArchive& inArchive) {
+		for (size_t i = 0; i < numFonts; ++i) {
+			inArchive << font;
+		}
+	}, [&](CArchive& inArchive) {
+		for (size_t i = 0; i < numFonts; ++i) {
+			SFont loaded;
+			inArchive >> loaded;
+			asts(loaded.mName == font.mName && loaded.letters.size() == font.letters.size(), "Font did not round trip.");
+		}
+	});
+}
+
+static size_t countObjects(const THierarchy<CWorldObject>& inHierarchy) {
+	size_t count = inHierarchy.getChildren().getSize();
+	inHierarchy.getChildren().forEach([&](size_t, const TUnique<CWorldObject>& inObject) {
+		count += countObjects(*inObject);
+	});
+	return count;
+}
+
+// Saved with a class table like the scene file is, so each object's class is an index instead of a name
+ADD_BENCHMARK(SerializeScene) {
+	constexpr size_t numParents = 1000;
+	constexpr size_t numChildren = 99;
+
+	// Not through TUnique, so it doesn't load or save Scene.scn
+	CScene scene;
+	for (size_t i = 0; i < numParents; ++i) {
+		TUnique<CWorldObject> parent{};
+		parent->mName = fmts("Object {}", i);
+		parent->setPosition(Vector3f{static_cast<float>(i), 0.f, 0.f});
+		for (size_t c = 0; c < numChildren; ++c) {
+			TUnique<CWorldObject> child{};
+			child->setPosition(Vector3f{0.f, static_cast<float>(c), 0.f});
+			parent->addChild(std::move(child));
+		}
+		scene.addChild(std::move(parent));
+	}
+
+	const size_t numObjects = countObjects(scene);
+
+	SClassTable classTable;
+	benchmarkRoundTrip("CScene (100k objects)", numObjects, [&](CArchive& inArchive) {
+		inArchive.setClassTable(&classTable);
+		inArchive << scene;
+	}, [&](CArchive& inArchive) {
+		inArchive.setClassTable(&classTable);
+		CScene loaded;
+		inArchive >> loaded;
+		asts(countObjects(loaded) == numObjects, "Scene loaded {} of {} objects.", countObjects(loaded), numObjects);
+	});
+}
+
+class CBenchmarkShape : public SObject, public ISerializable {
+
+	REGISTER_CLASS(CBenchmarkShape, SObject)
+
+public:
+
+	virtual CArchive& save(CArchive& inArchive) const override {
+		inArchive << mPosition;
+		return inArchive;
+	}
+
+	virtual CArchive& load(CArchive& inArchive) override {
+		inArchive >> mPosition;
+		return inArchive;
+	}
+
+	Vector3f mPosition{0.f};
+};
+
+class CBenchmarkSphere : public CBenchmarkShape {
+
+	REGISTER_CLASS(CBenchmarkSphere, CBenchmarkShape)
+
+public:
+
+	virtual CArchive& save(CArchive& inArchive) const override {
+		CBenchmarkShape::save(inArchive);
+		inArchive << mRadius;
+		return inArchive;
+	}
+
+	virtual CArchive& load(CArchive& inArchive) override {
+		CBenchmarkShape::load(inArchive);
+		inArchive >> mRadius;
+		return inArchive;
+	}
+
+	float mRadius = 1.f;
+};
+
+class CBenchmarkBox : public CBenchmarkShape {
+
+	REGISTER_CLASS(CBenchmarkBox, CBenchmarkShape)
+
+public:
+
+	virtual CArchive& save(CArchive& inArchive) const override {
+		CBenchmarkShape::save(inArchive);
+		inArchive << mExtents;
+		return inArchive;
+	}
+
+	virtual CArchive& load(CArchive& inArchive) override {
+		CBenchmarkShape::load(inArchive);
+		inArchive >> mExtents;
+		return inArchive;
+	}
+
+	Vector3f mExtents{1.f};
+};
+
+// Once with class names inline, once with a class table, so both paths of writeClass are covered
+ADD_BENCHMARK(SerializePolymorphicList) {
+	constexpr size_t numObjects = 100000;
+
+	TList<TUnique<CBenchmarkShape>> shapes;
+	for (size_t i = 0; i < numObjects; ++i) {
+		if (i % 2 == 0) {
+			TUnique<CBenchmarkSphere> sphere{};
+			sphere->mRadius = static_cast<float>(i);
+			shapes.push(std::move(sphere));
+		} else {
+			TUnique<CBenchmarkBox> box{};
+			box->mExtents = Vector3f{static_cast<float>(i)};
+			shapes.push(std::move(box));
+		}
+	}
+
+	auto checkShapes = [&](const TList<TUnique<CBenchmarkShape>>& inLoaded) {
+		asts(inLoaded.getSize() == numObjects, "Loaded {} of {} shapes.", inLoaded.getSize(), numObjects);
+		inLoaded.forEach([&](const size_t inIndex, const TUnique<CBenchmarkShape>& inShape) {
+			asts(inShape->getClass() == shapes[inIndex]->getClass(), "Shape {} loaded as {}.", inIndex, inShape->getClass()->getName());
+		});
+	};
+
+	benchmarkRoundTrip("TUnique list (names)", numObjects, [&](CArchive& inArchive) {
+		inArchive << shapes;
+	}, [&](CArchive& inArchive) {
+		TList<TUnique<CBenchmarkShape>> loaded;
+		inArchive >> loaded;
+		checkShapes(loaded);
+	});
+
+	SClassTable classTable;
+	benchmarkRoundTrip("TUnique list (table)", numObjects, [&](CArchive& inArchive) {
+		inArchive.setClassTable(&classTable);
+		inArchive << shapes;
+	}, [&](CArchive& inArchive) {
+		inArchive.setClassTable(&classTable);
+		TList<TUnique<CBenchmarkShape>> loaded;
+		inArchive >> loaded;
+		checkShapes(loaded);
+	});
+}
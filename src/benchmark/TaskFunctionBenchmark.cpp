@@ -0,0 +1,85 @@
+#include <memory>
+
+#include "Benchmark.h"
+#include "basic/core/Threading.h"
+
+// Typical engine lambdas have to be stored, moved and run without touching the heap
+ADD_BENCHMARK(TaskFunctionAllocations) {
+	constexpr uint32 numTasks = 100000;
+
+	struct SLarge {
+		char mData[200];
+	};
+
+	uint32 counter = 0;
+	auto shared = std::make_shared<uint32>(0);
+	const std::string name = "Example Task";
+	SLarge large{};
+
+	// Lets the thread's free lists warm up, pooled blocks are only allocated the first time
+	{
+		FTask warmup = [large, &counter] { counter += large.mData[0]; };
+		warmup();
+	}
+
+	const auto countAllocations = [&](const char* inName, auto&& inMakeTask) {
+		const uint64 before = SBenchmark::getAllocations();
+		for (uint32 i = 0; i < numTasks; ++i) {
+			FTask task = inMakeTask(i);
+			FTask moved = std::move(task);
+			moved();
+		}
+		const uint64 allocations = SBenchmark::getAllocations() - before;
+		msgs("{:<28} {:>8} allocations for {} tasks", inName, allocations, numTasks);
+		return allocations;
+	};
+
+	const uint64 byReference = countAllocations("Capture by reference:", [&](const uint32 i) {
+		return FTask{[&counter, i] { counter += i; }};
+	});
+	const uint64 sharedPointer = countAllocations("Capture shared pointer:", [&](const uint32 i) {
+		return FTask{[shared, i] { *shared += i; }};
+	});
+	const uint64 pooled = countAllocations("Capture 200 bytes (pooled):", [&](const uint32 i) {
+		return FTask{[large, &counter, i] { counter += large.mData[i % sizeof(large.mData)]; }};
+	});
+
+	asts(byReference == 0, "Capture by reference allocated {} times.", byReference);
+	asts(sharedPointer == 0, "Capture shared pointer allocated {} times.", sharedPointer);
+	asts(pooled == 0, "Pooled capture allocated {} times.", pooled);
+
+	// For comparison, std::function allocates once the capture gets larger than a couple of pointers
+	const uint64 before = SBenchmark::getAllocations();
+	for (uint32 i = 0; i < numTasks; ++i) {
+		std::function<void()> task = [&counter, shared, name, i] { counter += i + static_cast<uint32>(name.size()); };
+		task();
+	}
+	msgs("{:<28} {:>8} allocations for {} tasks", "std::function (string copy):", SBenchmark::getAllocations() - before, numTasks);
+
+	// Strings allocate on their own, so only the FTask itself is expected to be free here
+	const uint64 beforeString = SBenchmark::getAllocations();
+	for (uint32 i = 0; i < numTasks; ++i) {
+		FTask task = [&counter, shared, name, i] { counter += i + static_cast<uint32>(name.size()); };
+		task();
+	}
+	msgs("{:<28} {:>8} allocations for {} tasks", "FTask (string copy):", SBenchmark::getAllocations() - beforeString, numTasks);
+}
+
+// Main thread style queue, tasks are added and then drained
+ADD_BENCHMARK(WorkerQueueThroughput) {
+	constexpr uint32 numTasks = 200000;
+
+	CWorker worker;
+	uint64 sum = 0;
+	const uint64 before = SBenchmark::getAllocations();
+	const double seconds = timeFunction([&] {
+		for (uint32 i = 0; i < numTasks; ++i) {
+			worker.add([&sum, i] { sum += i; });
+		}
+		worker.executeAll();
+	});
+	const uint64 allocations = SBenchmark::getAllocations() - before;
+
+	asts(sum == static_cast<uint64>(numTasks) * (numTasks - 1) / 2, "Worker lost tasks.");
+	msgs("{:>12.0f} tasks/s, {:.3f} allocations per task", numTasks / seconds, static_cast<double>(allocations) / numTasks);
+}
@@ -0,0 +1,101 @@
+#include <atomic>
+
+#include "Benchmark.h"
+#include "basic/core/Threading.h"
+
+// Roughly the cost of a small per-frame job
+static void spinWork(const uint32 inIterations) {
+	volatile uint32 value = 0;
+	for (uint32 i = 0; i < inIterations; ++i) {
+		value = value + i;
+	}
+}
+
+// Thread counts from 1 up to the number of cores, doubling each time
+static std::vector<uint32> getThreadCounts() {
+	std::vector<uint32> counts;
+	const uint32 maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	for (uint32 count = 1; count < maxThreads; count *= 2) {
+		counts.push_back(count);
+	}
+	counts.push_back(maxThreads);
+	return counts;
+}
+
+// Tasks all submitted from the calling thread
+ADD_BENCHMARK(ThreadPoolExternalSubmit) {
+	constexpr uint32 numTasks = 200000;
+
+	for (const uint32 numThreads : getThreadCounts()) {
+		CThreadPool pool{numThreads};
+		const double seconds = bestTime(3, [&] {
+			for (uint32 i = 0; i < numTasks; ++i) {
+				pool.run([] { spinWork(200); });
+			}
+			pool.wait();
+		});
+		msgs("{:>3} threads: {:>12.0f} tasks/s", numThreads, numTasks / seconds);
+	}
+}
+
+// Tasks that spawn their own children, which stay on the spawning thread's deque unless stolen
+ADD_BENCHMARK(ThreadPoolNestedSubmit) {
+	constexpr uint32 numParents = 2000;
+	constexpr uint32 numChildren = 100;
+
+	for (const uint32 numThreads : getThreadCounts()) {
+		CThreadPool pool{numThreads};
+		const double seconds = bestTime(3, [&] {
+			for (uint32 i = 0; i < numParents; ++i) {
+				pool.run([&pool] {
+					for (uint32 c = 0; c < numChildren; ++c) {
+						pool.run([] { spinWork(200); });
+					}
+				});
+			}
+			pool.wait();
+		});
+		msgs("{:>3} threads: {:>12.0f} tasks/s", numThreads, numParents * (numChildren + 1) / seconds);
+	}
+}
+
+// A frame sized parallel loop while long running tasks keep the pools busy
+// Load on the normal lane takes every thread unless some are reserved, load on the background pool should barely be noticed
+ADD_BENCHMARK(FrameLatencyUnderLoad) {
+	constexpr size_t numItems = 1 << 16;
+	const uint32 numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	const auto measure = [&](const char* inName, const uint32 inLoadTasks, const ETaskPriority inLoadPriority, const uint32 inReservedThreads) {
+		CThreading::configure(numThreads, inReservedThreads, numThreads);
+
+		std::atomic<bool> stopLoad = false;
+		for (uint32 i = 0; i < inLoadTasks; ++i) {
+			CThreading::runOnBackgroundThread([&stopLoad] {
+				while (!stopLoad.load(std::memory_order_relaxed)) {
+					spinWork(1000);
+				}
+			}, inLoadPriority);
+		}
+
+		// Give the load time to occupy the threads
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		const double seconds = bestTime(5, [] {
+			CThreading::parallelFor(0, numItems, 1024, [](size_t) {
+				spinWork(20);
+			});
+		});
+
+		stopLoad.store(true, std::memory_order_relaxed);
+		CThreading::wait();
+
+		msgs("{:<32} {:>8.3f}ms", inName, seconds * 1000.0);
+	};
+
+	measure("No load:", 0, ETaskPriority::NORMAL, 0);
+	measure("Normal load:", numThreads, ETaskPriority::NORMAL, 0);
+	measure("Normal load, half reserved:", numThreads, ETaskPriority::NORMAL, numThreads / 2);
+	measure("Background load:", numThreads, ETaskPriority::BACKGROUND, 0);
+
+	CThreading::configure(numThreads, 0, numThreads);
+}
@@ -107,7 +107,7 @@ void CEditorSpritePass::render(const SRendererInfo& info, const TFrail<CVRIComma
 				SInstance instance;
 			};
 
-			SFont& font = CEngineLoader::getFonts().begin()->second;
+			SFont& font = *CEngineLoader::getFonts().resolve(CEngineLoader::getFonts().getNames().begin()->second);
 
 			std::vector<SData> datas;
 
@@ -1,9 +1,12 @@
 ﻿#pragma once
 
 #include "basic/core/Common.h"
+#include "engine/FramePacer.h"
 #include "rendercore/Renderer.h"
+#include "rendercore/RenderProxy.h"
 
 class CInput;
+class CRenderThread;
 
 class CEngine : public SObject {
 
@@ -46,6 +49,9 @@ private:
 
 	EXPORT void update();
 
+	// Updates the scene and captures it for rendering
+	EXPORT void updateScene(SRenderSnapshot& outSnapshot);
+
 	Time m_Time{};
 
 	TUnique<CEngineViewport> m_EngineViewport = nullptr;
@@ -56,4 +62,14 @@ private:
 
 	TUnique<CScene> m_Scene = nullptr;
 
+	// Only exists while rendering is pipelined
+	TUnique<CRenderThread> m_RenderThread = nullptr;
+
+	// Used instead of the render thread's snapshots when rendering on the game thread
+	SRenderSnapshot m_Snapshot{};
+
+	CFramePacer m_FramePacer{};
+
+	uint64 m_Frame = 0;
+
 };
\ No newline at end of file
@@ -1,12 +1,18 @@
 ﻿#pragma once
 
+#include <mutex>
 #include <vector>
 
 #include "basic/core/Singleton.h"
+#include "basic/core/SettingsSnapshot.h"
 
 class CGuiText;
 class CCommand;
 
+/*
+ * Settings are only ever written and read on the game thread
+ * The UI draws from a snapshot instead, and its edits are queued until the game thread applies them at the start of a frame
+ */
 class CEngineSettings : public SObject {
 
 	REGISTER_CLASS(CEngineSettings, SObject)
@@ -17,18 +23,40 @@ public:
 	// Get a certain command, is O(n) but is at compile time
 	EXPORT static CCommand* getCommand(const std::string& inCommand);
 
-	EXPORT static void render();
+	// Game thread, applies any edits made in the UI since the last call
+	EXPORT static void applyEdits();
+
+	// Game thread, copies every game thread text and every command's value
+	EXPORT static void capture(SSettingsSnapshot& outSnapshot);
+
+	// Draws the settings from a snapshot, edits are queued instead of being written
+	EXPORT static void render(const SSettingsSnapshot& inSnapshot);
 
 private:
 
-	// Commands need to add themselves
+	// Commands and texts need to add themselves
 	friend class CCommand;
+	friend class CGuiText;
+
+	// Add command to the settings, returns its index in the snapshot
+	EXPORT static size_t addCommand(const std::string& inCommand, CCommand* inCommandType);
 
-	// Add command to the settings
-	EXPORT static void addCommand(const std::string& inCommand, CCommand* inCommandType);
+	// Add game thread text to the settings, returns its index in the snapshot
+	EXPORT static size_t addText(CGuiText* inText);
+
+	// The value a command should show, an edit that hasn't been applied yet is newer than the snapshot
+	EXPORT static SCommandValue getValue(size_t inIndex, const SSettingsSnapshot& inSnapshot);
+
+	EXPORT static void edit(size_t inIndex, const SCommandValue& inValue);
 
 	std::vector<std::pair<std::string, CCommand*>> m_Commands;
 
+	std::vector<CGuiText*> m_Texts;
+
+	std::mutex m_EditMutex;
+
+	std::vector<std::pair<size_t, SCommandValue>> m_Edits;
+
 };
 
 class CGuiType {
@@ -80,7 +108,7 @@ protected:
 		//getCategoryMap().push_back(item);
 	}
 
-	virtual void render() = 0;
+	virtual void render(const SSettingsSnapshot& inSnapshot) = 0;
 
 	virtual uint32 getTypeOrder() const = 0;
 
@@ -88,6 +116,12 @@ protected:
 
 };
 
+// The thread that calls setText, the UI only reads game thread texts through the snapshot
+enum class EGuiThread : uint8 {
+	GAME,
+	RENDER
+};
+
 class CGuiText : public CGuiType {
 
 public:
@@ -95,12 +129,17 @@ public:
 	CGuiText(const std::string& inCategory)
 	: CGuiType(inCategory),
 	m_Text("") {
+		m_Index = CEngineSettings::addText(this);
 		insertToMap();
 	}
 
-	CGuiText(const std::string& inCategory, const std::string& inText)
+	CGuiText(const std::string& inCategory, const std::string& inText, const EGuiThread inThread = EGuiThread::GAME)
 	: CGuiType(inCategory),
-	m_Text(inText) {
+	m_Text(inText),
+	m_Thread(inThread) {
+		if (m_Thread == EGuiThread::GAME) {
+			m_Index = CEngineSettings::addText(this);
+		}
 		insertToMap();
 	}
 
@@ -114,7 +153,7 @@ public:
 
 private:
 
-	EXPORT virtual void render() override;
+	EXPORT virtual void render(const SSettingsSnapshot& inSnapshot) override;
 
 	virtual uint32 getTypeOrder() const override {
 		return 0;
@@ -122,6 +161,10 @@ private:
 
 	std::string m_Text;
 
+	EGuiThread m_Thread = EGuiThread::GAME;
+
+	size_t m_Index = 0;
+
 };
 
 class CCommand : public CGuiType {
@@ -142,7 +185,7 @@ public:
 	m_Command(inCommand),
 	m_Type(Type::BOOL) {
 		m_Value.bValue = inDefaultValue;
-		CEngineSettings::addCommand(inCommand, this);
+		m_Index = CEngineSettings::addCommand(inCommand, this);
 		insertToMap();
 	}
 
@@ -155,7 +198,7 @@ public:
 			.min = inMinValue,
 			.max = inMaxValue
 		};
-		CEngineSettings::addCommand(inCommand, this);
+		m_Index = CEngineSettings::addCommand(inCommand, this);
 		insertToMap();
 	}
 
@@ -168,7 +211,7 @@ public:
 			.min = inMinValue,
 			.max = inMaxValue
 		};
-		CEngineSettings::addCommand(inCommand, this);
+		m_Index = CEngineSettings::addCommand(inCommand, this);
 		insertToMap();
 	}
 
@@ -177,7 +220,7 @@ public:
 	m_Command(inCommand),
 	m_Type(Type::EXTENT) {
 		m_Value.extent = inDefaultValue;
-		CEngineSettings::addCommand(inCommand, this);
+		m_Index = CEngineSettings::addCommand(inCommand, this);
 		insertToMap();
 	}
 
@@ -186,7 +229,7 @@ public:
 	m_Command(inCommand),
 	m_Type(Type::VECTOR2) {
 		m_Value.vector2 = inDefaultValue;
-		CEngineSettings::addCommand(inCommand, this);
+		m_Index = CEngineSettings::addCommand(inCommand, this);
 		insertToMap();
 	}
 
@@ -195,7 +238,7 @@ public:
 	m_Command(inCommand),
 	m_Type(Type::VECTOR3) {
 		m_Value.vector3 = inDefaultValue;
-		CEngineSettings::addCommand(inCommand, this);
+		m_Index = CEngineSettings::addCommand(inCommand, this);
 		insertToMap();
 	}
 
@@ -204,7 +247,7 @@ public:
 	m_Command(inCommand),
 	m_Type(Type::VECTOR4) {
 		m_Value.vector4 = inDefaultValue;
-		CEngineSettings::addCommand(inCommand, this);
+		m_Index = CEngineSettings::addCommand(inCommand, this);
 		insertToMap();
 	}
 
@@ -218,40 +261,37 @@ protected:
 
 	Type m_Type;
 
-	union {
-		bool bValue;
-		struct {
-			int32 val;
-			int32 min;
-			int32 max;
-		} iValue;
-		struct {
-			float val;
-			float min;
-			float max;
-		} fValue;
-		Extent32 extent;
-		Vector2f vector2;
-		Vector3f vector3;
-		Vector4f vector4;
-	} m_Value;
+	// Only written on the game thread
+	SCommandValue m_Value;
+
+	// Where the value is in a settings snapshot
+	size_t m_Index = 0;
 
 private:
 
+	// Engine settings copies values into snapshots and applies edits
+	friend class CEngineSettings;
+
+	EXPORT virtual void render(const SSettingsSnapshot& inSnapshot) override;
+
+	// Draws a widget for a copy of the value, returns true if it was edited
+	virtual bool renderValue(SCommandValue& ioValue) = 0;
+
 	virtual uint32 getTypeOrder() const override {
 		return (uint32)m_Type + 1;
 	}
-	
+
 };
 
+// Each returns true if the value was edited
 namespace CommandRenderType {
-	EXPORT void checkbox(const char* inCommand, bool* outValue);
-	EXPORT void intSlider(const char* inCommand, int32* outValue, int32 min, int32 max);
-	EXPORT void floatSlider(const char* inCommand, float* outValue, float min, float max);
-	EXPORT void int2Input(const char* inCommand, int32* outValue);
-	EXPORT void float2Input(const char* inCommand, float* outValue);
-	EXPORT void float3Input(const char* inCommand, float* outValue);
-	EXPORT void float4Input(const char* inCommand, float* outValue);
+	EXPORT bool checkbox(const char* inCommand, bool* outValue);
+	EXPORT bool intSlider(const char* inCommand, int32* outValue, int32 min, int32 max);
+	EXPORT bool floatSlider(const char* inCommand, float* outValue, float min, float max);
+	EXPORT bool int2Input(const char* inCommand, int32* outValue);
+	EXPORT bool float2Input(const char* inCommand, float* outValue);
+	EXPORT bool float3Input(const char* inCommand, float* outValue);
+	EXPORT bool float4Input(const char* inCommand, float* outValue);
 }
 
 template <typename TType>
@@ -268,23 +308,14 @@ public:
 	: CCommand(inCategory, inCommand, inDefaultValue, inMinValue, inMaxValue) {
 	}
 
+	// Game thread
 	no_discard Type get() {
-		if constexpr(std::is_same_v<Type, bool>) {
-			return m_Value.bValue;
-		} else if constexpr(std::is_same_v<Type, int32>) {
-			return m_Value.iValue.val;
-		} else if constexpr(std::is_same_v<Type, float>) {
-			return m_Value.fValue.val;
-		} else if constexpr(std::is_same_v<Type, Extent32>) {
-			return m_Value.extent;
-		} else if constexpr(std::is_same_v<Type, Vector2f>) {
-			return m_Value.vector2;
-		} else if constexpr(std::is_same_v<Type, Vector3f>) {
-			return m_Value.vector3;
-		} else if constexpr(std::is_same_v<Type, Vector4f>) {
-			return m_Value.vector4;
-		}
-		errs("Command {} has invalid type.", getCategory());
+		return getValue(m_Value);
+	}
+
+	// Render thread, the value as it was when the snapshot was captured
+	no_discard Type get(const SSettingsSnapshot& inSnapshot) {
+		return getValue(inSnapshot.mValues[m_Index]);
 	}
 
 	no_discard Type getMin() {
@@ -333,22 +364,42 @@ public:
 
 private:
 
-	virtual void render() override {
+	no_discard Type getValue(const SCommandValue& inValue) const {
+		if constexpr(std::is_same_v<Type, bool>) {
+			return inValue.bValue;
+		} else if constexpr(std::is_same_v<Type, int32>) {
+			return inValue.iValue.val;
+		} else if constexpr(std::is_same_v<Type, float>) {
+			return inValue.fValue.val;
+		} else if constexpr(std::is_same_v<Type, Extent32>) {
+			return inValue.extent;
+		} else if constexpr(std::is_same_v<Type, Vector2f>) {
+			return inValue.vector2;
+		} else if constexpr(std::is_same_v<Type, Vector3f>) {
+			return inValue.vector3;
+		} else if constexpr(std::is_same_v<Type, Vector4f>) {
+			return inValue.vector4;
+		}
+		errs("Command {} has invalid type.", getCategory());
+	}
+
+	virtual bool renderValue(SCommandValue& ioValue) override {
 		if constexpr (std::is_same_v<TType, bool>) {
-			CommandRenderType::checkbox(m_Command.c_str(), &m_Value.bValue);
+			return CommandRenderType::checkbox(m_Command.c_str(), &ioValue.bValue);
 		} else if constexpr (std::is_same_v<TType, int32>) {
-			CommandRenderType::intSlider(m_Command.c_str(), &m_Value.iValue.val, m_Value.iValue.min, m_Value.iValue.max);
+			return CommandRenderType::intSlider(m_Command.c_str(), &ioValue.iValue.val, ioValue.iValue.min, ioValue.iValue.max);
 		} else if constexpr (std::is_same_v<TType, float>) {
-			CommandRenderType::floatSlider(m_Command.c_str(), &m_Value.fValue.val, m_Value.fValue.min, m_Value.fValue.max);
+			return CommandRenderType::floatSlider(m_Command.c_str(), &ioValue.fValue.val, ioValue.fValue.min, ioValue.fValue.max);
 		} else if constexpr (std::is_same_v<TType, Extent32>) {
-			CommandRenderType::int2Input(m_Command.c_str(), (int32*)&m_Value.extent);
+			return CommandRenderType::int2Input(m_Command.c_str(), (int32*)&ioValue.extent);
 		} else if constexpr (std::is_same_v<TType, Vector2f>) {
-			CommandRenderType::float2Input(m_Command.c_str(), (float*)&m_Value.vector2);
+			return CommandRenderType::float2Input(m_Command.c_str(), (float*)&ioValue.vector2);
 		} else if constexpr (std::is_same_v<TType, Vector3f>) {
-			CommandRenderType::float3Input(m_Command.c_str(), (float*)&m_Value.vector3);
+			return CommandRenderType::float3Input(m_Command.c_str(), (float*)&ioValue.vector3);
 		} else if constexpr (std::is_same_v<TType, Vector4f>) {
-			CommandRenderType::float4Input(m_Command.c_str(), (float*)&m_Value.vector4);
+			return CommandRenderType::float4Input(m_Command.c_str(), (float*)&ioValue.vector4);
 		}
+		return false;
 	}
 };
 
@@ -358,4 +409,8 @@ private:
 	)
 
 #define ADD_TEXT(type, ...) \
-	CGuiText type(SETTINGS_CATEGORY, __VA_ARGS__)
\ No newline at end of file
+	CGuiText type(SETTINGS_CATEGORY, __VA_ARGS__)
+
+// For texts set while rendering, the UI draws them directly since it is on the same thread
+#define ADD_RENDER_TEXT(type, text) \
+	CGuiText type(SETTINGS_CATEGORY, text, EGuiThread::RENDER)
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+
+#include "basic/core/Common.h"
+
+/*
+ * Holds frames to a target frame time
+ * The OS only sleeps with a precision of about a millisecond, so most of the wait is slept and the rest is spun
+ * How much is spun follows how late the OS has been waking us up, so the spin stays short when the scheduler is precise
+ * Deadlines are scheduled from the previous deadline instead of from when the frame ended, so small errors don't add up
+ */
+class CFramePacer {
+
+public:
+
+	typedef std::chrono::steady_clock Clock;
+
+	// Waits until the next frame should start, returns immediately if the frame went over
+	EXPORT void pace(double inTargetFrameTime);
+
+	// Forgets the current schedule, the next frame starts a new one
+	void reset() {
+		m_Deadline = Clock::time_point{};
+	}
+
+	// Moving average of how far from the deadline frames actually started, in seconds
+	no_discard double getAverageError() const {
+		return m_AverageError;
+	}
+
+	// Largest error since the last reset, in seconds
+	no_discard double getMaxError() const {
+		return m_MaxError;
+	}
+
+	// How much of the wait is currently spun instead of slept, in seconds
+	no_discard double getSpinTime() const {
+		return m_SpinTime;
+	}
+
+	void resetError() {
+		m_AverageError = 0.0;
+		m_MaxError = 0.0;
+	}
+
+private:
+
+	void waitUntil(Clock::time_point inDeadline);
+
+	Clock::time_point m_Deadline{};
+
+	double m_SpinTime = 0.001;
+
+	double m_AverageError = 0.0;
+
+	double m_MaxError = 0.0;
+};
@@ -3,6 +3,7 @@
 #include "SceneObject.h"
 
 class CObjectRenderer;
+struct SRenderSnapshot;
 
 struct IRenderable {
 	virtual IInstancer& getInstancer() = 0;
@@ -62,6 +63,9 @@ public:
 
 	virtual IInstancer& getInstancer() override = 0;
 
+	// Called on the game thread, copies whatever the renderer needs into the snapshot
+	virtual void addProxies(SRenderSnapshot& outSnapshot, const Matrix4f& inTransform) {}
+
 };
 
 #undef MAKE_RENDERABLE
\ No newline at end of file
@@ -1,6 +1,11 @@
 ﻿#pragma once
 
+#include <mutex>
+
 #include "SceneObject.h"
+#include "basic/core/Threading.h"
+
+struct SRenderSnapshot;
 
 class CScene : public SObject, public THierarchy<CWorldObject>, public IInitializable, public IDestroyable {
 
@@ -14,5 +19,22 @@ public:
 
 	EXPORT virtual void update();
 
+	// Captures the camera and every renderable object for the render thread
+	EXPORT void gatherProxies(SRenderSnapshot& outSnapshot);
+
+	// Serializes the scene into memory under the mutex, then compresses and writes it on the background pool
+	// If the last save is still writing, that one is returned instead of starting another
+	EXPORT CTaskHandle saveAsync();
+
 	TShared<class CCamera> mMainCamera = nullptr;
+
+	// Held while the scene is updated or gathered, anything touching objects from another thread (like editor UI) must hold it too
+	std::mutex mMutex;
+
+private:
+
+	CTaskHandle m_SaveTask;
+
+	// How big the last snapshot was, the next one reserves that much up front
+	size_t m_LastSaveSize = 0;
 };
\ No newline at end of file
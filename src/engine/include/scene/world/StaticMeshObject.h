@@ -3,6 +3,7 @@
 #include "rendercore/StaticMesh.h"
 #include "scene/base/RenderableObject.h"
 #include "rendercore/EngineLoader.h"
+#include "rendercore/RenderProxy.h"
 
 // A scene object that has the capability to render static meshes
 class CStaticMeshObject : public CRenderableWorldObject {
@@ -13,25 +14,42 @@ public:
 
 	CStaticMeshObject() = default;
 
-	CStaticMeshObject(SStaticMesh* inMesh): mesh(inMesh) {}
+	CStaticMeshObject(const TAssetHandle<SStaticMesh> inMesh): mesh(inMesh) {}
 
 	virtual IInstancer& getInstancer() override {
 		return m_Instancer;
 	}
 
+	// Null if the mesh was never set, or has since been removed
 	no_discard virtual SStaticMesh* getMesh() const {
-		return mesh;
+		return CEngineLoader::getMeshes().resolve(mesh);
 	}
 
-	SStaticMesh* mesh;
+	TAssetHandle<SStaticMesh> mesh{};
+
+	virtual void addProxies(SRenderSnapshot& outSnapshot, const Matrix4f& inTransform) override {
+		SStaticMesh* staticMesh = getMesh();
+		if (!staticMesh) return;
+
+		// Streams the mesh in the first time it is drawn, the renderer draws its bounds until it is resident
+		if (!staticMesh->isResident()) CEngineLoader::requestMesh(staticMesh);
+
+		IInstancer& instancer = getInstancer();
+		outSnapshot.addProxy(SStaticMeshProxy{
+			.mTransform = inTransform,
+			.mMesh = staticMesh,
+			.mInstances = outSnapshot.addInstances(instancer.getInstanceData(), instancer.getNumberOfInstances())
+		});
+	}
 
 	virtual CArchive& save(CArchive& inArchive) const override {
 		CWorldObject::save(inArchive);
-		const bool hasMesh = mesh != nullptr;
+		const SStaticMesh* staticMesh = getMesh();
+		const bool hasMesh = staticMesh != nullptr;
 		// Save the mesh's name
 		inArchive << hasMesh;
 		if (hasMesh) {
-			inArchive << mesh->name;
+			inArchive << staticMesh->name;
 		}
 		return inArchive;
 	}
@@ -44,7 +62,7 @@ public:
 		if (hasMesh) {
 			std::string name;
 			inArchive >> name;
-			mesh = CEngineLoader::getMeshes()[name].get();
+			mesh = CEngineLoader::requestMesh(name);
 		}
 
 		return inArchive;
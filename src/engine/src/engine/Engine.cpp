@@ -7,17 +7,32 @@
 #include "engine/Input.h"
 #include "scene/base/Scene.h"
 #include "rendercore/Renderer.h"
+#include "rendercore/RenderThread.h"
 #include "basic/core/Threading.h"
-#include "SDL3/SDL_timer.h"
 #include "tracy/Tracy.hpp"
 
 #define SETTINGS_CATEGORY "Engine"
 ADD_COMMAND(bool, UseFrameCap, true);
 ADD_COMMAND(int32, FrameCap, 180, 30, 500);
+ADD_COMMAND(bool, PipelinedRendering, true);
+ADD_COMMAND(float, MainThreadBudget, 2.f, 0.f, 33.f); // Milliseconds, only used when the frame cap is off
+ADD_COMMAND(int32, AutosaveInterval, 0, 0, 600); // Seconds, 0 turns autosave off
+ADD_TEXT(MainThreadTasks);
+ADD_TEXT(FramePacing);
 ADD_TEXT(FrameRate);
 ADD_TEXT(AverageFrameRate);
 ADD_TEXT(GameTime);
 ADD_TEXT(DeltaTime);
+ADD_TEXT(Autosave);
+#undef SETTINGS_CATEGORY
+
+static const int32 gHardwareThreads = std::max(static_cast<int32>(std::thread::hardware_concurrency()), 1);
+
+#define SETTINGS_CATEGORY "Threading"
+ADD_COMMAND(int32, WorkerThreads, gHardwareThreads, 1, gHardwareThreads);
+ADD_COMMAND(int32, ReservedFrameThreads, 0, 0, gHardwareThreads - 1); // Worker threads that only run frame tasks
+ADD_COMMAND(int32, BackgroundThreads, std::max(gHardwareThreads / 4, 1), 1, gHardwareThreads); // IO and compression
+ADD_TEXT(ThreadPoolTasks);
 #undef SETTINGS_CATEGORY
 
 TFrail<CRenderer> CRenderer::get() {
@@ -44,6 +59,8 @@ void CEngine::run_internal() {
 	m_Scene = TUnique<CScene>{};
 
 	auto previousTime = std::chrono::high_resolution_clock::now();
+	double latencyResetTime = 0.0;
+	double autosaveTime = 0.0;
 	bool bPauseRendering = false;
 	bool bRunning = true;
 	while (bRunning) {
@@ -63,11 +80,23 @@ void CEngine::run_internal() {
 			previousTime = currentTime;
 		}
 
+		// Settings edited in the UI last frame take effect from here on
+		CEngineSettings::applyEdits();
+
 		DeltaTime.setText(fmts("Delta Time: {}", std::to_string(m_Time.mDeltaTime)));
 		FrameRate.setText(fmts("Frame Rate: {}", std::to_string(m_Time.mFrameRate)));
 		AverageFrameRate.setText(fmts("Average Frame Rate: {}", std::to_string(m_Time.mAverageFrameRate)));
 		GameTime.setText(fmts("Game Time: {}", std::to_string(m_Time.mGameTime)));
 
+		// Pools only change if the settings did
+		{
+			CThreading::configure(WorkerThreads.get(), ReservedFrameThreads.get(), BackgroundThreads.get());
+
+			const CThreadPool& workerPool = CThreading::getThreadPool(ETaskPriority::NORMAL);
+			const CThreadPool& backgroundPool = CThreading::getThreadPool(ETaskPriority::BACKGROUND);
+			ThreadPoolTasks.setText(fmts("Queued Tasks: {} frame, {} normal, {} background", workerPool.getNumberOfQueuedTasks(ETaskPriority::FRAME), workerPool.getNumberOfQueuedTasks(ETaskPriority::NORMAL), backgroundPool.getNumberOfQueuedTasks(ETaskPriority::BACKGROUND)));
+		}
+
 		// Tick input
 		m_Input->tick();
 
@@ -78,6 +107,7 @@ void CEngine::run_internal() {
 		if (bPauseRendering) {
 			// Throttle the speed to avoid the endless spinning
 			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			m_FramePacer.reset();
 			continue;
 		}
 
@@ -88,25 +118,83 @@ void CEngine::run_internal() {
 			m_Renderer
 		};
 
-		// Draw to the screen
-		m_Renderer->render(info);
+		if (PipelinedRendering.get()) {
+			if (!m_RenderThread) {
+				m_RenderThread = TUnique<CRenderThread>{info};
+			}
+
+			// Waits if the render thread hasn't started on the last frame yet
+			updateScene(m_RenderThread->beginFrame());
+
+			// The render thread draws this frame while we move on to the next one
+			m_RenderThread->endFrame();
+		} else {
+			// Finish whatever the render thread was drawing before taking over
+			if (m_RenderThread) {
+				m_RenderThread.destroy();
+			}
+
+			m_Snapshot.clear();
+			updateScene(m_Snapshot);
+			info.snapshot = &m_Snapshot;
+
+			// Draw to the screen
+			m_Renderer->render(info);
+		}
+
+		m_Frame++;
+
+		// Only the snapshot is taken on this thread, the save itself runs on the background pool
+		if (AutosaveInterval.get() > 0 && m_Time.mGameTime - autosaveTime > AutosaveInterval.get()) {
+			autosaveTime = m_Time.mGameTime;
+
+			const auto snapshotStart = std::chrono::high_resolution_clock::now();
+			m_Scene->saveAsync();
+			Autosave.setText(fmts("Autosave: {:.3f}ms snapshot at {:.0f}s", std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - snapshotStart).count() * 1000.0, m_Time.mGameTime));
+		}
 
 		// Execute any tasks that are on the 'main thread'
-		// Done here because they can be done during the frame cap wait
-		CThreading::getMainThread().executeAll();
+		// Done here so they use up the frame cap wait, anything that doesn't fit carries over to the next frame
+		{
+			ZoneScopedN("Main Thread Tasks");
+
+			double budget = MainThreadBudget.get() / 1000.0;
+			if (UseFrameCap.get()) {
+				const double frameTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - previousTime).count();
+				budget = std::max(1.0 / FrameCap.get() - frameTime, 0.0);
+			}
+
+			CWorker& mainThread = CThreading::getMainThread();
+			mainThread.executeUntil(CWorker::Clock::now() + std::chrono::duration_cast<CWorker::Clock::duration>(std::chrono::duration<double>(budget)));
+
+			MainThreadTasks.setText(fmts("Main Thread Tasks: {} queued, {:.2f}ms average wait, {:.2f}ms max wait", mainThread.getNumberOfTasks(), mainThread.getAverageQueueLatency() * 1000.0, mainThread.getMaxQueueLatency() * 1000.0));
+
+			// Max wait is over the last second, otherwise one bad hitch would stick around forever
+			if (m_Time.mGameTime - latencyResetTime > 1.0) {
+				latencyResetTime = m_Time.mGameTime;
+				mainThread.resetQueueLatency();
+				m_FramePacer.resetError();
+			}
+		}
 
 		// If we go over the target framerate, delay
-		// Ensure no divide by 0
 		if (UseFrameCap.get()) {
 			ZoneScopedN("Frame Cap Wait");
 
-			const double TargetDeltaTime = 1.0 / FrameCap.get();
-			if (const auto frameTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - previousTime).count(); TargetDeltaTime > frameTime) {
-				SDL_Delay(static_cast<uint32>((TargetDeltaTime - frameTime) * 1000.0));
-			}
+			m_FramePacer.pace(1.0 / FrameCap.get());
+
+			FramePacing.setText(fmts("Frame Pacing: {:.3f}ms average error, {:.3f}ms max error, {:.2f}ms spin", m_FramePacer.getAverageError() * 1000.0, m_FramePacer.getMaxError() * 1000.0, m_FramePacer.getSpinTime() * 1000.0));
+		} else {
+			m_FramePacer.reset();
+			FramePacing.setText("Frame Pacing: Off");
 		}
 	}
 
+	// Let the render thread finish its last frame
+	if (m_RenderThread) {
+		m_RenderThread.destroy();
+	}
+
 	// Wait for the gpu to finish instructions
 	if (!m_Renderer->wait()) {
 		errs("Engine did not stop properly!");
@@ -121,6 +209,24 @@ void CEngine::run_internal() {
 
 }
 
+void CEngine::updateScene(SRenderSnapshot& outSnapshot) {
+	ZoneScopedN("Scene Update");
+
+	// Everything the renderer needs from the engine is copied, so the render thread never touches the viewport or settings
+	outSnapshot.mViewportExtent = m_EngineViewport->mExtent;
+	outSnapshot.mViewportResized = m_EngineViewport->isDirty();
+	m_EngineViewport->clean();
+	outSnapshot.mMousePosition = m_Input->getMousePosition();
+	outSnapshot.mDeltaTime = static_cast<float>(m_Time.mDeltaTime);
+	CEngineSettings::capture(outSnapshot.mSettings);
+
+	std::lock_guard lock(m_Scene->mMutex);
+	m_Scene->update();
+
+	outSnapshot.mFrame = m_Frame;
+	m_Scene->gatherProxies(outSnapshot);
+}
+
 // Test game loop
 void CEngine::update() {
 	ZoneScopedN("Game Loop");
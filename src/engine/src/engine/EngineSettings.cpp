@@ -17,9 +17,65 @@ CCommand* CEngineSettings::getCommand(const std::string& inCommand) {
 	return outCommand;
 }
 
-void CEngineSettings::addCommand(const std::string& inCommand, CCommand* inCommandType) {
+size_t CEngineSettings::addCommand(const std::string& inCommand, CCommand* inCommandType) {
 	//ast(!get().m_Commands.contains(inCommand), "Command {} already defined.", inCommand);
 	get()->m_Commands.emplace_back(inCommand, inCommandType);
+	return get()->m_Commands.size() - 1;
+}
+
+size_t CEngineSettings::addText(CGuiText* inText) {
+	get()->m_Texts.push_back(inText);
+	return get()->m_Texts.size() - 1;
+}
+
+void CEngineSettings::applyEdits() {
+	const auto settings = get();
+
+	std::lock_guard lock(settings->m_EditMutex);
+	for (const auto&[index, value] : settings->m_Edits) {
+		settings->m_Commands[index].second->m_Value = value;
+	}
+	settings->m_Edits.clear();
+}
+
+void CEngineSettings::capture(SSettingsSnapshot& outSnapshot) {
+	ZoneScopedN("Capture Settings");
+
+	const auto settings = get();
+
+	// Assigned in place, so the snapshot's strings keep their capacity between frames
+	outSnapshot.mTexts.resize(settings->m_Texts.size());
+	for (size_t i = 0; i < settings->m_Texts.size(); ++i) {
+		outSnapshot.mTexts[i] = settings->m_Texts[i]->getText();
+	}
+
+	outSnapshot.mValues.resize(settings->m_Commands.size());
+	for (size_t i = 0; i < settings->m_Commands.size(); ++i) {
+		outSnapshot.mValues[i] = settings->m_Commands[i].second->m_Value;
+	}
+}
+
+SCommandValue CEngineSettings::getValue(const size_t inIndex, const SSettingsSnapshot& inSnapshot) {
+	const auto settings = get();
+
+	std::lock_guard lock(settings->m_EditMutex);
+	for (const auto&[index, value] : settings->m_Edits) {
+		if (index == inIndex) return value;
+	}
+	return inSnapshot.mValues[inIndex];
+}
+
+void CEngineSettings::edit(const size_t inIndex, const SCommandValue& inValue) {
+	const auto settings = get();
+
+	std::lock_guard lock(settings->m_EditMutex);
+	for (auto&[index, value] : settings->m_Edits) {
+		if (index == inIndex) {
+			value = inValue;
+			return;
+		}
+	}
+	settings->m_Edits.emplace_back(inIndex, inValue);
 }
 
 std::vector<std::pair<std::string, std::vector<CGuiType*>>>& CGuiType::getCategoryMap() {
@@ -27,11 +83,17 @@ std::vector<std::pair<std::string, std::vector<CGuiType*>>>& CGuiType::getCatego
 	return map;
 }
 
-void CGuiText::render() {
-	ImGui::Text(m_Text.c_str());
+void CGuiText::render(const SSettingsSnapshot& inSnapshot) {
+	ImGui::Text(m_Thread == EGuiThread::GAME ? inSnapshot.mTexts[m_Index].c_str() : m_Text.c_str());
+}
+
+void CCommand::render(const SSettingsSnapshot& inSnapshot) {
+	if (SCommandValue value = CEngineSettings::getValue(m_Index, inSnapshot); renderValue(value)) {
+		CEngineSettings::edit(m_Index, value);
+	}
 }
 
-void CEngineSettings::render() {
+void CEngineSettings::render(const SSettingsSnapshot& inSnapshot) {
 	ZoneScopedN("Engine UI");
 
 	if (ImGui::Begin("Engine Settings")) {
@@ -39,7 +101,7 @@ void CEngineSettings::render() {
 			for (auto&[category, guiTypes] : CGuiType::getCategoryMap()) {
 				if (ImGui::BeginTabItem(category.c_str())) {
 					for (auto& command : guiTypes) {
-						command->render();
+						command->render(inSnapshot);
 					}
 					ImGui::EndTabItem();
 				}
@@ -50,31 +112,31 @@ void CEngineSettings::render() {
 	ImGui::End();
 }
 
-void CommandRenderType::checkbox(const char* inCommand, bool* outValue) {
-	ImGui::Checkbox(inCommand, outValue);
+bool CommandRenderType::checkbox(const char* inCommand, bool* outValue) {
+	return ImGui::Checkbox(inCommand, outValue);
 }
 
-void CommandRenderType::intSlider(const char* inCommand, int32* outValue, const int32 min, const int32 max) {
-	ImGui::SliderInt(inCommand, outValue, min, max);
+bool CommandRenderType::intSlider(const char* inCommand, int32* outValue, const int32 min, const int32 max) {
+	return ImGui::SliderInt(inCommand, outValue, min, max);
 }
 
-void CommandRenderType::floatSlider(const char* inCommand, float* outValue, const float min, const float max) {
-	ImGui::SliderFloat(inCommand, outValue, min, max);
+bool CommandRenderType::floatSlider(const char* inCommand, float* outValue, const float min, const float max) {
+	return ImGui::SliderFloat(inCommand, outValue, min, max);
 }
 
-void CommandRenderType::int2Input(const char* inCommand, int32* outValue) {
-	ImGui::InputInt2(inCommand, outValue);
+bool CommandRenderType::int2Input(const char* inCommand, int32* outValue) {
+	return ImGui::InputInt2(inCommand, outValue);
 }
 
-void CommandRenderType::float2Input(const char* inCommand, float* outValue) {
-	ImGui::InputFloat2(inCommand, outValue);
+bool CommandRenderType::float2Input(const char* inCommand, float* outValue) {
+	return ImGui::InputFloat2(inCommand, outValue);
 
 }
 
-void CommandRenderType::float3Input(const char* inCommand, float* outValue) {
-	ImGui::InputFloat3(inCommand, outValue);
+bool CommandRenderType::float3Input(const char* inCommand, float* outValue) {
+	return ImGui::InputFloat3(inCommand, outValue);
 }
 
-void CommandRenderType::float4Input(const char* inCommand, float* outValue) {
-	ImGui::InputFloat4(inCommand, outValue);
+bool CommandRenderType::float4Input(const char* inCommand, float* outValue) {
+	return ImGui::InputFloat4(inCommand, outValue);
 }
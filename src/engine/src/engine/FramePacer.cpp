@@ -0,0 +1,58 @@
+#include "engine/FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "SDL3/SDL_timer.h"
+#include "tracy/Tracy.hpp"
+
+// Added on top of the measured oversleep, so an average wake up still lands in the spin
+constexpr static double gSpinMargin = 0.0002;
+
+// Past this the scheduler is too coarse to be worth spinning for, the frame will just be a little late
+constexpr static double gMaxSpinTime = 0.004;
+
+void CFramePacer::pace(const double inTargetFrameTime) {
+	const auto target = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(inTargetFrameTime));
+	const Clock::time_point now = Clock::now();
+
+	if (m_Deadline == Clock::time_point{}) {
+		m_Deadline = now;
+	}
+	m_Deadline += target;
+
+	// Missed the deadline, start a new schedule instead of rushing the next frames to catch up
+	if (now >= m_Deadline) {
+		m_Deadline = now;
+		return;
+	}
+
+	waitUntil(m_Deadline);
+}
+
+void CFramePacer::waitUntil(const Clock::time_point inDeadline) {
+	// Coarse sleep, leaving enough time for the OS to wake us up late
+	if (const Clock::time_point sleepDeadline = inDeadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_SpinTime)); Clock::now() < sleepDeadline) {
+		ZoneScopedN("Frame Pacer Sleep");
+
+		SDL_DelayNS(std::chrono::duration_cast<std::chrono::nanoseconds>(sleepDeadline - Clock::now()).count());
+
+		// Follows a late wake up immediately, and only slowly shortens the spin once the scheduler behaves again
+		const double oversleep = std::chrono::duration<double>(Clock::now() - sleepDeadline).count();
+		const double spinTime = std::clamp(oversleep + gSpinMargin, 0.0, gMaxSpinTime);
+		m_SpinTime = spinTime > m_SpinTime ? spinTime : m_SpinTime * 0.95 + spinTime * 0.05;
+	}
+
+	// Spin the rest, yielding so another thread that needs the core still gets it
+	{
+		ZoneScopedN("Frame Pacer Spin");
+
+		while (Clock::now() < inDeadline) {
+			std::this_thread::yield();
+		}
+	}
+
+	const double error = std::chrono::duration<double>(Clock::now() - inDeadline).count();
+	m_AverageError = m_AverageError * 0.9 + error * 0.1;
+	m_MaxError = std::max(m_MaxError, error);
+}
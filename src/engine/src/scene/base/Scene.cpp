@@ -1,14 +1,22 @@
 ﻿#include "scene/base/Scene.h"
 
 #include "scene/world/Camera.h"
+#include "scene/base/RenderableObject.h"
+#include "rendercore/RenderProxy.h"
+#include "basic/core/ChunkArchive.h"
+#include "tracy/Tracy.hpp"
+
+constexpr static uint32 gSceneChunk = makeChunkType("SCNE");
+
+static std::string getScenePath() {
+	return SPaths::get()->mAssetPath.string() + "Scene.scn";
+}
 
 void CScene::init() {
-	std::filesystem::path path = SPaths::get()->mAssetPath.string() + "Scene.scn";
+	const std::string path = getScenePath();
 
 	if (std::filesystem::exists(path)) {
-		CFileArchive file(path.string(), "rb");
-		file >> *this;
-		file.close();
+		readChunkFile(path, gSceneChunk, *this);
 	}
 
 	mMainCamera = TShared<CCamera>{};
@@ -17,13 +25,58 @@ void CScene::init() {
 void CScene::destroy() {
 	mMainCamera.destroy();
 
-	std::filesystem::path path = SPaths::get()->mAssetPath.string() + "Scene.scn";
+	// An autosave could still be writing the same file
+	m_SaveTask.wait();
 
-	CFileArchive file(path.string(), "wb");
-	file << *this;
-	file.close();
+	// Saved on this thread, the pools may already be shutting down
+	writeChunkFile(getScenePath(), gSceneChunk, 1, *this);
+}
+
+CTaskHandle CScene::saveAsync() {
+	if (!m_SaveTask.isComplete()) return m_SaveTask;
+
+	// Only the serialization into memory needs the scene, so that is all the game thread pays for
+	// It is still every object's save, so it grows with the scene, the engine reports how long it took
+	auto writer = std::make_shared<CChunkWriter>();
+	CMemoryArchive& archive = writer->addChunk(gSceneChunk, 1);
+
+	// Sized after the last save outside of the lock, so the buffer isn't regrown and copied while the scene waits
+	archive.reserve(m_LastSaveSize);
+	{
+		ZoneScopedN("Scene Snapshot");
+		std::lock_guard lock(mMutex);
+		archive << *this;
+	}
+	m_LastSaveSize = archive.getSize();
+
+	// The writer owns the snapshot, so the scene can keep changing while it is compressed and written
+	m_SaveTask = CThreading::runTask([writer, path = getScenePath()] {
+		ZoneScopedN("Scene Save");
+		writer->writeToFile(path);
+	}, {}, ETaskPriority::BACKGROUND);
+
+	return m_SaveTask;
 }
 
 void CScene::update() {
 	mMainCamera->update();
 }
+
+static void gatherChildProxies(SRenderSnapshot& outSnapshot, THierarchy<CWorldObject>* inHierarchy, const Matrix4f& inParentTransform) {
+	inHierarchy->getChildren().forEach([&](size_t index, TUnique<CWorldObject>& obj) {
+		const Matrix4f transform = inParentTransform * obj->getTransformMatrix();
+
+		if (const auto renderable = dynamic_cast<CRenderableWorldObject*>(obj.get())) {
+			renderable->addProxies(outSnapshot, transform);
+		}
+
+		gatherChildProxies(outSnapshot, obj.get(), transform);
+	});
+}
+
+void CScene::gatherProxies(SRenderSnapshot& outSnapshot) {
+	outSnapshot.mViewProjection = mMainCamera->getViewProjectionMatrix();
+	outSnapshot.mCameraPosition = mMainCamera->getPosition();
+
+	gatherChildProxies(outSnapshot, this, Matrix4f{1.f});
+}
@@ -2,10 +2,16 @@
 
 #include <filesystem>
 #include <map>
+#include <mutex>
+#include <span>
 #include <string>
+#include <vector>
 
 #include "Font.h"
+#include "basic/core/AssetTable.h"
+#include "basic/core/ChunkArchive.h"
 #include "basic/core/Paths.h"
+#include "basic/core/Threading.h"
 #include "rendercore/StaticMesh.h"
 
 struct SStaticMesh;
@@ -13,6 +19,10 @@ class CMaterial;
 
 // Represents a vertex
 struct SVertex {
+
+	// Serialized member by member with no padding in between, so vertex arrays can be written in one go
+	constexpr static bool mBitwiseSerializable = true;
+
 	Vector3f position{0.f};
 	uint32 uv = 0u;
 	Vector3f normal{0.f};
@@ -48,6 +58,8 @@ struct SVertex {
 	}
 };
 
+static_assert(sizeof(SVertex) == 32 && offsetof(SVertex, color) == 28, "SVertex serialization assumes a tightly packed layout with color last.");
+
 struct SMeshData {
 
 	SMeshData() = default;
@@ -76,25 +88,103 @@ struct SMeshData {
 
 	// We are storing indices as an 'uint24' to reduce storage size
 	struct storedIndex {
+		constexpr static bool mBitwiseSerializable = true;
+
 		uint8 i1, i2, i3;
 	};
 
+	// Vertices without color are stored up to the color, which is the last member
+	constexpr static size_t mUncoloredVertexSize = offsetof(SVertex, color);
+
 	bool mHasVertexColor = false;
 	std::vector<uint32> indices{};
 	std::vector<SVertex> vertices{};
 	std::vector<Surface> surfaces{};
+	// Index ranges past the full detail surfaces' indices, which share the same vertices
+	std::vector<SMeshLod> lods{};
+	std::vector<SMeshlet> meshlets{};
 	SBounds bounds{};
 
-	friend CArchive& operator<<(CArchive& inArchive, const SMeshData& inData) {
-		inArchive << inData.mHasVertexColor;
+	// How buildLods simplifies a mesh
+	struct SLodSettings {
+		// Including the full detail level, up to SStaticMesh::mMaxLods
+		uint32 mLodCount = 4;
+
+		// Each level aims for this fraction of the previous level's triangles
+		float mReduction = 0.5f;
+
+		// The furthest a level can stray from the full mesh, relative to its size
+		float mMaxError = 0.1f;
+	};
+
+	// Chunks in .msh files, so a loader can read just the bounds or just the surfaces
+	// Version 2 vertex and index chunks are meshopt encoded, version 1 chunks are the same data as the plain stream
+	constexpr static uint32 mVertexChunk = makeChunkType("VERT");
+	constexpr static uint32 mIndexChunk = makeChunkType("INDX");
+	constexpr static uint32 mSurfaceChunk = makeChunkType("SURF");
+	constexpr static uint32 mBoundsChunk = makeChunkType("BNDS");
+	// Optional, files without it only have the full detail level
+	constexpr static uint32 mLodChunk = makeChunkType("LODS");
+	// Optional, files without it are drawn a whole surface at a time
+	constexpr static uint32 mMeshletChunk = makeChunkType("MSHL");
+
+	constexpr static uint32 mEncodedChunkVersion = 2;
+
+	enum class EVertexEncoding : uint32 {
+		// Every vertex decodes bit for bit
+		LOSSLESS,
+		// Positions are 16 bit within the mesh's bounds, and normals are 16 bit octahedral
+		// Decoded back to full vertices on load, so nothing past the loader sees the difference
+		QUANTIZED
+	};
+
+	// Encoded vertex and index chunks start with these, so the sizes are known before anything is decoded
+	struct SVertexChunkHeader {
+		constexpr static bool mBitwiseSerializable = true;
+
+		uint64 mCount = 0;
+		EVertexEncoding mEncoding = EVertexEncoding::LOSSLESS;
+		uint32 mHasVertexColor = 0;
+
+		// Quantized positions are mPositionOrigin + value * mPositionScale
+		Vector3f mPositionOrigin{0.f};
+		Vector3f mPositionScale{0.f};
+	};
+
+	struct SIndexChunkHeader {
+		constexpr static bool mBitwiseSerializable = true;
+
+		uint64 mCount = 0;
+	};
+
+	// The encoded chunks of a mesh file, pointing into the reader
+	// Lets the loader allocate the staging buffer first, then decode indices straight into it
+	struct SEncoded {
+
+		// False for version 1 chunks, or if either chunk is missing or damaged
+		EXPORT bool read(CChunkReader& inReader);
+
+		// The destinations have to be exactly the size in the headers
+		// Quantized vertices are decoded across the pool, so never while holding an upload batcher allocation
+		EXPORT bool decodeVertices(std::span<SVertex> outVertices) const;
+
+		EXPORT bool decodeIndices(std::span<uint32> outIndices) const;
 
+		SVertexChunkHeader mVertexHeader;
+		SIndexChunkHeader mIndexHeader;
+
+		std::span<const uint8> mVertexData;
+		std::span<const uint8> mIndexData;
+	};
+
+	void saveIndices(CArchive& inArchive) const {
 		std::vector<uint8> indices0;
 		std::vector<uint16> indices1;
 		std::vector<storedIndex> indices2;
 		std::vector<uint32> indices3;
 
 		// Smart index pushing to remove spaces inbetween indices
-		for (auto index : inData.indices) {
+		for (auto index : indices) {
 			if ((index & 0xff00) == 0 && indices1.empty()) {
 				indices0.push_back(index & 0xff);
 				continue;
@@ -117,25 +207,9 @@ struct SMeshData {
 		inArchive << indices1;
 		inArchive << indices2;
 		inArchive << indices3;
-		inArchive << inData.vertices.size();
-
-		// Since vertex colors are optional, they are not always serialized
-		for (const auto& value : inData.vertices) {
-			inArchive << value.position;
-			inArchive << value.uv;
-			inArchive << value.normal;
-			if (inData.mHasVertexColor)
-				inArchive << value.color;
-		}
-
-		inArchive << inData.surfaces;
-		inArchive << inData.bounds;
-		return inArchive;
 	}
 
-	friend CArchive& operator>>(CArchive& inArchive, SMeshData& inData) {
-		inArchive >> inData.mHasVertexColor;
-
+	void loadIndices(CArchive& inArchive) {
 		std::vector<uint8> indices0;
 		std::vector<uint16> indices1;
 		std::vector<storedIndex> indices2;
@@ -146,26 +220,73 @@ struct SMeshData {
 		inArchive >> indices2;
 		inArchive >> indices3;
 
-		inData.indices.append_range(indices0);
-		inData.indices.append_range(indices1);
+		indices.append_range(indices0);
+		indices.append_range(indices1);
 		for (auto [i1, i2, i3] : indices2) {
 			const int32 i = i1 | i2 << 8 | i3 << 16;
-			inData.indices.push_back(i);
+			indices.push_back(i);
 		}
-		inData.indices.append_range(indices3);
+		indices.append_range(indices3);
+	}
+
+	void saveVertices(CArchive& inArchive) const {
+		inArchive << vertices.size();
 
+		// Since vertex colors are optional, they are not always serialized
+		if (mHasVertexColor) {
+			inArchive.writeSpan(vertices.data(), vertices.size());
+		} else {
+			// Packed without color first, so it is still a single write
+			std::vector<uint8> packed(vertices.size() * mUncoloredVertexSize);
+			for (size_t i = 0; i < vertices.size(); ++i) {
+				memcpy(packed.data() + i * mUncoloredVertexSize, &vertices[i], mUncoloredVertexSize);
+			}
+			inArchive.writeSpan(packed.data(), packed.size());
+		}
+	}
+
+	void loadVertices(CArchive& inArchive) {
 		size_t size;
 		inArchive >> size;
-		inData.vertices.resize(size);
-		for (size_t i = 0; i < size; ++i) {
-			inArchive >> inData.vertices[i].position;
-			inArchive >> inData.vertices[i].uv;
-			inArchive >> inData.vertices[i].normal;
-			if (inData.mHasVertexColor) {
-				inArchive >> inData.vertices[i].color;
+		vertices.resize(size);
+		if (mHasVertexColor) {
+			inArchive.readSpan(vertices.data(), size);
+		} else {
+			std::vector<uint8> packed(size * mUncoloredVertexSize);
+			inArchive.readSpan(packed.data(), packed.size());
+			for (size_t i = 0; i < size; ++i) {
+				memcpy(&vertices[i], packed.data() + i * mUncoloredVertexSize, mUncoloredVertexSize);
 			}
 		}
+	}
+
+	// Simplifies every surface from the full detail indices, and appends each level's indices after them
+	// Stops early once a level can't get much smaller without going over the error
+	EXPORT void buildLods(const SLodSettings& inSettings);
+
+	// Splits the full detail surfaces into meshlets, and reorders each surface's indices so every meshlet is a contiguous range
+	EXPORT void buildMeshlets();
+
+	// Quantizing is lossy, so it is left to whoever imports the mesh
+	EXPORT void saveChunks(CChunkWriter& inWriter, EVertexEncoding inEncoding = EVertexEncoding::LOSSLESS) const;
+
+	// Every chunk is needed to draw the mesh, so a missing one fails the whole load
+	EXPORT bool loadChunks(CChunkReader& inReader);
+
+	// The plain stream that .msh files used before they were chunked
+	friend CArchive& operator<<(CArchive& inArchive, const SMeshData& inData) {
+		inArchive << inData.mHasVertexColor;
+		inData.saveIndices(inArchive);
+		inData.saveVertices(inArchive);
+		inArchive << inData.surfaces;
+		inArchive << inData.bounds;
+		return inArchive;
+	}
 
+	friend CArchive& operator>>(CArchive& inArchive, SMeshData& inData) {
+		inArchive >> inData.mHasVertexColor;
+		inData.loadIndices(inArchive);
+		inData.loadVertices(inArchive);
 		inArchive >> inData.surfaces;
 		inArchive >> inData.bounds;
 		return inArchive;
@@ -177,29 +298,33 @@ class CEngineLoader : public SObject {
 	REGISTER_CLASS(CEngineLoader, SObject)
 	MAKE_SINGLETON(CEngineLoader)
 
+	// Serialized into memory first, so the file is written in one go
 	template <typename TType>
-	static void save(const std::string& inFileName, TType inValue) {
+	static void save(const std::string& inFileName, const uint32 inChunkType, const uint32 inChunkVersion, const TType& inValue) {
 		std::filesystem::path path = SPaths::get()->mAssetPath;
 		path.append(inFileName);
 
-		CFileArchive file(path.string(), "wb");
-		file << inValue;
-		file.close();
+		writeChunkFile(path.string(), inChunkType, inChunkVersion, inValue);
 	}
 
+	// Assets are mapped instead of read through fread, since they are read once front to back
+	// Files from before chunk files are still read as a plain stream
 	template <typename TType>
-	static TType load(const std::filesystem::path& inPath) {
-		CFileArchive file(inPath.string(), "rb");
-
+	static TType load(const std::filesystem::path& inPath, const uint32 inChunkType) {
 		TType value;
-		file >> value;
-		file.close();
-
+		if (!readChunkFile(inPath.string(), inChunkType, value)) {
+			msgs("Could not read {}!", inPath.string());
+		}
 		return value;
 	}
 
 public:
 
+	// Chunks in asset files, see SMeshData for meshes
+	constexpr static uint32 mMaterialChunk = makeChunkType("MATL");
+	constexpr static uint32 mFontChunk = makeChunkType("FONT");
+	constexpr static uint32 mFontAtlasChunk = makeChunkType("ATLS");
+
 	CEngineLoader() = default;
 
 	EXPORT static void save();
@@ -212,9 +337,9 @@ public:
 
 	EXPORT static void importTexture(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath);
 
-	static std::map<std::string, TShared<SVRIImage>>& getImages() { return get()->mImages; }
+	static TAssetTable<SVRIImage>& getImages() { return get()->mImages; }
 
-	std::map<std::string, TShared<SVRIImage>> mImages{};
+	TAssetTable<SVRIImage> mImages{};
 
 	//
 	// Fonts
@@ -222,9 +347,9 @@ public:
 
 	EXPORT static void importFont(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath);
 
-	static std::map<std::string, SFont>& getFonts() { return get()->mFonts; }
+	static TAssetTable<SFont, SFont>& getFonts() { return get()->mFonts; }
 
-	std::map<std::string, SFont> mFonts{};
+	TAssetTable<SFont, SFont> mFonts{};
 
 	//
 	// Materials
@@ -232,18 +357,48 @@ public:
 
 	EXPORT static void createMaterial(const std::string& inMaterialName);
 
-	static std::map<std::string, TShared<CMaterial>>& getMaterials() { return get()->mMaterials; }
+	static TAssetTable<CMaterial>& getMaterials() { return get()->mMaterials; }
 
-	std::map<std::string, TShared<CMaterial>> mMaterials{};
+	TAssetTable<CMaterial> mMaterials{};
 
 	//
 	// Meshes
 	//
 
-	EXPORT static void importMesh(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath);
+	EXPORT static void importMesh(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath, SMeshData::EVertexEncoding inEncoding = SMeshData::EVertexEncoding::LOSSLESS, const SMeshData::SLodSettings& inLods = {});
+
+	// Reads only the bounds chunk, without loading the rest of the mesh
+	EXPORT static bool readMeshBounds(const std::filesystem::path& inPath, SBounds& outBounds);
+
+	// Starts streaming a registered mesh in, does nothing if it is resident or already on its way
+	EXPORT static void requestMesh(SStaticMesh* inMesh);
+
+	// Finds a mesh by name and requests it, the handle is invalid if no mesh has that name
+	// Only meant for loading, anything that draws the mesh should keep the handle
+	EXPORT static TAssetHandle<SStaticMesh> requestMesh(const std::string& inName);
+
+	// Streaming tasks upload through the renderer, so they have to finish before it is destroyed
+	EXPORT static void waitForStreaming();
+
+	static TAssetTable<SStaticMesh>& getMeshes() { return get()->mMeshes; }
+
+	TAssetTable<SStaticMesh> mMeshes{};
+
+private:
+
+	// Creates a mesh with only its bounds, which is streamed in the first time it is requested
+	static TShared<SStaticMesh> registerMesh(const std::filesystem::path& inPath, const std::string& inName);
+
+	struct SMeshDescriptor {
+		std::filesystem::path mPath;
+		uintmax_t mFileSize = 0;
+	};
+
+	// Registered meshes that haven't been requested yet
+	std::map<SStaticMesh*, SMeshDescriptor> m_PendingMeshes;
 
-	static std::map<std::string, TShared<SStaticMesh>>& getMeshes() { return get()->mMeshes; }
+	std::vector<CTaskHandle> m_StreamingTasks;
 
-	std::map<std::string, TShared<SStaticMesh>> mMeshes{};
+	std::mutex m_StreamingMutex;
 
 };
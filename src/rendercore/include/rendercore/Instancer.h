@@ -5,8 +5,16 @@
 #include "rendercore/RenderStack.h"
 #include "rendercore/VulkanResources.h"
 #include "basic/core/Archive.h"
+#include "basic/core/Threading.h"
+
+// Matrix multiplies are cheap, so instances are only split across threads in large batches
+constexpr static size_t gInstanceGrainSize = 4096;
 
 struct SInstance {
+
+	// Just a matrix, so instance arrays can be written in one go
+	constexpr static bool mBitwiseSerializable = true;
+
 	Matrix4f Transform{1.f};
 
 	friend CArchive& operator<<(CArchive& inArchive, const SInstance& inInstance) {
@@ -22,6 +30,8 @@ struct SInstance {
 
 struct IInstancer : TDirtyable<true> {
 	virtual size_t getNumberOfInstances() = 0;
+	// Local instance transforms, getNumberOfInstances long
+	virtual const SInstance* getInstanceData() = 0;
 	virtual TFrail<SVRIBuffer> get(SRenderStack& stack) = 0;
 	virtual void flush() = 0;
 };
@@ -42,13 +52,19 @@ struct SStaticInstancer : IInstancer {
 		return m_Instances.size();
 	}
 
+	virtual const SInstance* getInstanceData() override {
+		return m_Instances.data();
+	}
+
 	void reallocate(SRenderStack& stack) {
 
-		for (auto& instance : m_Instances) {
-			stack.push(instance.Transform);
-			instance.Transform = stack.get();
-			stack.pop();
-		}
+		stack.push();
+		const Matrix4f parent = stack.get();
+		stack.pop();
+
+		CThreading::parallelFor(m_Instances, gInstanceGrainSize, [&parent](SInstance& instance) {
+			instance.Transform = parent * instance.Transform;
+		});
 
 		m_InstanceBuffer.push(m_Instances.data());
 	}
@@ -104,6 +120,10 @@ struct SSingleInstancer : IInstancer {
 		return 1;
 	}
 
+	virtual const SInstance* getInstanceData() override {
+		return &m_Instance;
+	}
+
 	void reallocate(SRenderStack& stack) {
 
 		stack.push(m_Instance.Transform);
@@ -159,13 +179,19 @@ struct SDynamicInstancer : IInstancer {
 		return m_Instances.size();
 	}
 
+	virtual const SInstance* getInstanceData() override {
+		return m_Instances.data();
+	}
+
 	void reallocate(SRenderStack& stack) {
 
-		for (auto& instance : m_Instances) {
-			stack.push(instance.Transform);
-			instance.Transform = stack.get();
-			stack.pop();
-		}
+		stack.push();
+		const Matrix4f parent = stack.get();
+		stack.pop();
+
+		CThreading::parallelFor(m_Instances, gInstanceGrainSize, [&parent](SInstance& instance) {
+			instance.Transform = parent * instance.Transform;
+		});
 
 		const size_t bufferSize = m_Instances.size() * sizeof(SInstance);
 
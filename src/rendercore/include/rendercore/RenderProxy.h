@@ -0,0 +1,158 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "basic/core/Common.h"
+#include "basic/core/SettingsSnapshot.h"
+#include "rendercore/Instancer.h"
+
+struct SStaticMesh;
+class CMaterial;
+
+// A range of instances inside of a snapshot's instance array
+struct SInstanceRange {
+	uint32 mFirst = 0;
+	uint32 mCount = 0;
+};
+
+// Everything needed to draw a static mesh, captured by the game thread
+struct SStaticMeshProxy {
+	Matrix4f mTransform{1.f};
+	SStaticMesh* mMesh = nullptr;
+	// Overrides the mesh's surface materials if set
+	CMaterial* mMaterial = nullptr;
+	SInstanceRange mInstances{};
+};
+
+/*
+ * Static mesh proxies stored as a structure of arrays
+ * Passes that only need transforms or bounds don't have to pull meshes and materials into cache
+ */
+struct SStaticMeshProxies {
+
+	no_discard size_t getSize() const { return mMeshes.size(); }
+
+	void push(const SStaticMeshProxy& inProxy) {
+		mTransforms.push_back(inProxy.mTransform);
+		mMeshes.push_back(inProxy.mMesh);
+		mMaterials.push_back(inProxy.mMaterial);
+		mInstanceRanges.push_back(inProxy.mInstances);
+	}
+
+	no_discard SStaticMeshProxy get(const size_t inIndex) const {
+		return {mTransforms[inIndex], mMeshes[inIndex], mMaterials[inIndex], mInstanceRanges[inIndex]};
+	}
+
+	// Keeps capacity, so a steady scene stops allocating after the first few frames
+	void clear() {
+		mTransforms.clear();
+		mMeshes.clear();
+		mMaterials.clear();
+		mInstanceRanges.clear();
+	}
+
+	std::vector<Matrix4f> mTransforms;
+	std::vector<SStaticMesh*> mMeshes;
+	std::vector<CMaterial*> mMaterials;
+	std::vector<SInstanceRange> mInstanceRanges;
+};
+
+/*
+ * Immutable (once published) view of a frame of the scene
+ * The render thread only ever reads from this, never from scene objects, the viewport or the settings
+ */
+struct SRenderSnapshot {
+
+	void clear() {
+		mInstances.clear();
+		mStaticMeshes.clear();
+	}
+
+	// Copies the instances into the snapshot and returns where they ended up
+	SInstanceRange addInstances(const SInstance* inInstances, const size_t inCount) {
+		const SInstanceRange range {
+			static_cast<uint32>(mInstances.size()),
+			static_cast<uint32>(inCount)
+		};
+		mInstances.insert(mInstances.end(), inInstances, inInstances + inCount);
+		return range;
+	}
+
+	void addProxy(const SStaticMeshProxy& inProxy) {
+		mStaticMeshes.push(inProxy);
+	}
+
+	uint64 mFrame = 0;
+
+	Matrix4f mViewProjection{1.f};
+
+	Vector3f mCameraPosition{0.f};
+
+	Extent32u mViewportExtent{0};
+
+	// If the window was resized since the last snapshot, the swapchain has to be recreated
+	bool mViewportResized = false;
+
+	// Input for the UI, since the render thread can't ask the window for it
+	Vector2f mMousePosition{0.f};
+	float mDeltaTime = 0.f;
+
+	SSettingsSnapshot mSettings;
+
+	// Local instance transforms for every proxy, indexed by their instance ranges
+	std::vector<SInstance> mInstances;
+
+	SStaticMeshProxies mStaticMeshes;
+};
+
+/*
+ * Two snapshots, the game thread writes one while the render thread reads the other
+ * The game thread can only get one frame ahead, after that it waits for the render thread to catch up
+ */
+class CRenderSnapshotBuffer {
+
+	enum class ESnapshotState : uint8 {
+		EMPTY,
+		WRITING,
+		READY,
+		READING
+	};
+
+public:
+
+	// Game thread, waits until the snapshot from two frames ago has been rendered
+	EXPORT SRenderSnapshot& beginWrite();
+
+	// Game thread, hands the snapshot from beginWrite to the render thread
+	EXPORT void publish();
+
+	// Render thread, waits for a published snapshot, returns nullptr if stopped or timed out
+	EXPORT const SRenderSnapshot* acquire(std::chrono::milliseconds inTimeout);
+
+	// Render thread, gives the snapshot from acquire back to the game thread
+	EXPORT void release();
+
+	// Wakes up both sides, anything still waiting will return without a snapshot
+	EXPORT void stop();
+
+	no_discard EXPORT bool isStopped() const;
+
+private:
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_CV;
+
+	SRenderSnapshot m_Snapshots[2];
+	ESnapshotState m_States[2] = {ESnapshotState::EMPTY, ESnapshotState::EMPTY};
+
+	// Written to instead of a real snapshot after stopping
+	SRenderSnapshot m_Discarded;
+
+	uint64 m_WriteFrame = 0;
+	uint64 m_ReadFrame = 0;
+
+	bool m_Stop = false;
+};
@@ -1,53 +1,87 @@
 ﻿#pragma once
 
-#include <functional>
+#include <thread>
 
 #include "Renderer.h"
+#include "basic/core/CommandQueue.h"
 #include "basic/core/Threading.h"
+#include "rendercore/RenderProxy.h"
 #include "sstl/Memory.h"
-#include "sstl/Vector.h"
 
 #include "tracy/Tracy.hpp"
 
-class CRenderThread : public CPersistentThread {
+/*
+ * Renders frame N while the game thread simulates frame N + 1
+ * The game thread fills a snapshot between beginFrame and endFrame, the render thread only ever reads snapshots
+ */
+class CRenderThread {
 
 public:
 
-    struct Context : SRendererInfo {
+    struct Context : SRendererInfo {};
 
-        template <typename TRendererType>
-        requires std::is_base_of_v<CObjectRenderer, TRendererType>
-        void addRendererProxy(const TRendererType::Proxy& inProxy) {
-
-        }
-    };
-
-    //TODO: fill ctx
-    CRenderThread(): CPersistentThread([this] {
+    explicit CRenderThread(const SRendererInfo& inInfo): m_Thread([this, inInfo] {
         TracyCSetThreadName("Render Thread")
-        Context ctx;
-        while (true) {
-            TracyCZoneNC(zone, "Render Thread", 0xff0000, 1);
-            {
-                ZoneScopedN("Render");
-                ctx.renderer->render(ctx);
+        Context ctx{inInfo};
+        while (!m_Snapshots.isStopped()) {
+            // Times out so commands still get drained while the game thread is stalled (or blocked on a full queue)
+            const SRenderSnapshot* snapshot = m_Snapshots.acquire(std::chrono::milliseconds(1));
+            if (snapshot) {
+                TracyCZoneNC(zone, "Render Thread", 0xff0000, 1);
+                ctx.snapshot = snapshot;
+                {
+                    ZoneScopedN("Render");
+                    ctx.renderer->render(ctx);
+                }
+                ctx.snapshot = nullptr;
+                m_Snapshots.release();
+                TracyCZoneEnd(zone);
             }
             {
                 ZoneScopedN("Commands");
-                while (mRendererTaskQueue.getSize() > 0) {
-                    mRendererTaskQueue.top()(ctx);
-                    mRendererTaskQueue.pop();
-                }
+                mRendererTaskQueue.executeAll(ctx);
             }
-            TracyCZoneEnd(zone);
         }
+
+        // Anything enqueued after the last frame still needs to run
+        mRendererTaskQueue.executeAll(ctx);
     }) {}
 
-    void enqueue(const std::function<void(Context&)>& func) {
-        mRendererTaskQueue.push(func);
+    ~CRenderThread() {
+        stop();
+    }
+
+    // Game thread, waits if the render thread is still on the frame before last
+    SRenderSnapshot& beginFrame() {
+        return m_Snapshots.beginWrite();
+    }
+
+    // Game thread, the snapshot from beginFrame must not be touched after this
+    void endFrame() {
+        m_Snapshots.publish();
+    }
+
+    // Lets the current frame finish, then joins the render thread
+    void stop() {
+        m_Snapshots.stop();
+        m_Thread.stop();
+    }
+
+    // Safe to call from any thread other than the render thread
+    // If the queue is full this waits for the render thread to drain it, so commands are never dropped
+    template <typename TFunc>
+    void enqueue(TFunc&& func) {
+        while (!mRendererTaskQueue.push(std::forward<TFunc>(func))) {
+            std::this_thread::yield();
+        }
     }
 
 private:
 
-    TVector<std::function<void(Context&)>> mRendererTaskQueue;
+    CRenderSnapshotBuffer m_Snapshots;
+
+    TCommandQueue<void(Context&), 1024> mRendererTaskQueue;
+
+    // Last, so everything the thread uses exists before it starts
+    CPersistentThread m_Thread;
 };
@@ -26,6 +26,8 @@ struct SRendererInfo {
 	TFrail<class CScene> scene = nullptr;
 	TFrail<class CEngineViewport> viewport = nullptr;
 	TFrail<class CRenderer> renderer = nullptr;
+	// What the game thread captured for this frame, passes should draw from this instead of the scene
+	const struct SRenderSnapshot* snapshot = nullptr;
 };
 
 class CRenderer : public SObject, public IInitializable, public IDestroyable {
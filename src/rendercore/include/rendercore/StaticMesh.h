@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,6 +9,10 @@
 #include "rendercore/VulkanResources.h"
 
 struct SBounds {
+
+	// Serialized member by member with no padding in between
+	constexpr static bool mBitwiseSerializable = true;
+
 	Vector3f origin;
 	float sphereRadius;
 	Vector3f extents;
@@ -27,6 +32,95 @@ struct SBounds {
 	}
 };
 
+// Part of a mesh's index buffer
+struct SIndexRange {
+	constexpr static bool mBitwiseSerializable = true;
+
+	uint32 mStartIndex = 0;
+	uint32 mCount = 0;
+
+	friend CArchive& operator<<(CArchive& inArchive, const SIndexRange& inRange) {
+		inArchive << inRange.mStartIndex;
+		inArchive << inRange.mCount;
+		return inArchive;
+	}
+
+	friend CArchive& operator>>(CArchive& inArchive, SIndexRange& inRange) {
+		inArchive >> inRange.mStartIndex;
+		inArchive >> inRange.mCount;
+		return inArchive;
+	}
+};
+
+// A simplified level of detail, drawn from the same vertices as the full mesh
+struct SMeshLod {
+
+	// How far the simplified surfaces can stray from the full mesh, as a fraction of the bounding sphere's radius
+	float mError = 0.f;
+
+	// One range per surface in the same order, so materials still come from the surfaces
+	std::vector<SIndexRange> mSurfaces;
+
+	friend CArchive& operator<<(CArchive& inArchive, const SMeshLod& inLod) {
+		inArchive << inLod.mError;
+		inArchive << inLod.mSurfaces;
+		return inArchive;
+	}
+
+	friend CArchive& operator>>(CArchive& inArchive, SMeshLod& inLod) {
+		inArchive >> inLod.mError;
+		inArchive >> inLod.mSurfaces;
+		return inArchive;
+	}
+};
+
+// A small cluster of a surface's triangles, which can be culled on its own
+struct SMeshlet {
+
+	// Serialized member by member with no padding in between
+	constexpr static bool mBitwiseSerializable = true;
+
+	// Bounding sphere of the triangles
+	Vector3f mCenter{0.f};
+	float mRadius = 0.f;
+
+	// Every triangle faces away from a camera if the direction from it to the apex, dotted with the axis, is at least the cutoff
+	Vector3f mConeApex{0.f};
+	float mConeCutoff = 1.f;
+	Vector3f mConeAxis{0.f};
+
+	// The triangles, which are contiguous within their surface's range
+	uint32 mStartIndex = 0;
+	uint32 mCount = 0;
+	uint32 mSurface = 0;
+
+	friend CArchive& operator<<(CArchive& inArchive, const SMeshlet& inMeshlet) {
+		inArchive << inMeshlet.mCenter;
+		inArchive << inMeshlet.mRadius;
+		inArchive << inMeshlet.mConeApex;
+		inArchive << inMeshlet.mConeCutoff;
+		inArchive << inMeshlet.mConeAxis;
+		inArchive << inMeshlet.mStartIndex;
+		inArchive << inMeshlet.mCount;
+		inArchive << inMeshlet.mSurface;
+		return inArchive;
+	}
+
+	friend CArchive& operator>>(CArchive& inArchive, SMeshlet& inMeshlet) {
+		inArchive >> inMeshlet.mCenter;
+		inArchive >> inMeshlet.mRadius;
+		inArchive >> inMeshlet.mConeApex;
+		inArchive >> inMeshlet.mConeCutoff;
+		inArchive >> inMeshlet.mConeAxis;
+		inArchive >> inMeshlet.mStartIndex;
+		inArchive >> inMeshlet.mCount;
+		inArchive >> inMeshlet.mSurface;
+		return inArchive;
+	}
+};
+
+static_assert(sizeof(SMeshlet) == 56, "SMeshlet serialization assumes a tightly packed layout.");
+
 struct SStaticMesh : public SObject {
 
 	REGISTER_STRUCT(SStaticMesh, SObject)
@@ -41,12 +135,36 @@ struct SStaticMesh : public SObject {
 		uint32 count;
 	};
 
+	// Level 0 is the surfaces themselves, so there can be at most this many minus one in lods
+	constexpr static uint32 mMaxLods = 8;
+
 	std::string name{"None"};
 
 	SBounds bounds;
 	std::vector<Surface> surfaces;
+	// Ordered from most to least detailed, each one with a larger error than the last
+	std::vector<SMeshLod> lods;
+	// Clusters of the full detail surfaces, in surface order
+	std::vector<SMeshlet> meshlets;
 	TUnique<SVRIMeshBuffer> meshBuffers;
 
+	// Streamed meshes start out with only their name and bounds, surfaces and buffers are filled in on a background thread
+	// They can only be read once this is set, until then the renderer draws the bounds instead
+	std::atomic<bool> resident = true;
+
+	no_discard bool isResident() const {
+		return resident.load(std::memory_order_acquire);
+	}
+
+	// The least detailed level whose error stays under inMaxError pixels, when the bounding sphere's radius covers inProjectedRadius pixels
+	no_discard uint32 selectLod(const float inProjectedRadius, const float inMaxError) const {
+		uint32 lod = 0;
+		while (lod < lods.size() && lods[lod].mError * inProjectedRadius <= inMaxError) {
+			++lod;
+		}
+		return lod;
+	}
+
 	friend uint32 getHash(const SStaticMesh& inMesh) {
 		return getHash(inMesh.name);
 	}
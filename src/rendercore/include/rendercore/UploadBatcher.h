@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "basic/core/Common.h"
+#include "rendercore/Renderer.h"
+#include "VRI/VRIResources.h"
+
+class CVRICommands;
+
+/*
+ * Gathers uploads into one staging buffer and records all of their commands into one command buffer
+ * A batch is submitted, and waited on, once when the staging buffer fills up or when it is flushed
+ * Instead of a submit and a fence wait per mesh or mip level
+ *
+ * Staging memory is handed to the caller first, so data can be decoded straight into it
+ * Every allocation has to be committed before the same thread allocates again, since a full batch waits for them
+ * Allocations are committed on the thread that made them, allocate and flush assert the rule
+ * So nothing that can run other tasks on the thread (a parallel for, or waiting on a task) belongs between allocate and commit
+ */
+class CUploadBatcher {
+
+public:
+
+	constexpr static size_t mDefaultCapacity = 64 * 1024 * 1024;
+
+	typedef std::function<void(const TFrail<CVRICommands>&)> FRecord;
+
+	// Called at submit time with the staging buffer and where the allocation starts in it
+	typedef std::function<void(const TFrail<CVRICommands>&, const TFrail<SVRIBuffer>&, size_t)> FRecordCopy;
+
+	struct SAllocation {
+		std::span<uint8> mData;
+		size_t mOffset = 0;
+	};
+
+	// Totals since the batcher was created
+	struct SStats {
+		uint64 mBytes = 0;
+		uint64 mBatches = 0;
+		uint64 mCopies = 0;
+		// Spent recording, submitting and waiting on the fence
+		double mSeconds = 0.0;
+	};
+
+	EXPORT explicit CUploadBatcher(const TFrail<CRenderer>& inRenderer, size_t inCapacity = mDefaultCapacity);
+
+	// Submits whatever is left
+	EXPORT ~CUploadBatcher();
+
+	CUploadBatcher(const CUploadBatcher&) = delete;
+	CUploadBatcher& operator=(const CUploadBatcher&) = delete;
+
+	// Held by loading threads while they create or free gpu resources, so imports running side by side create them one at a time
+	// The allocator's tracking and the bindless set lock themselves, which also covers resources made on the render thread
+	// Never hold it while calling into a batcher, a full batch can wait on allocations from threads that need it
+	EXPORT static std::mutex& getResourceMutex();
+
+	// Reserves staging memory, submitting the batch first if it doesn't fit
+	// Uploads bigger than the whole buffer grow it
+	EXPORT SAllocation allocate(size_t inSize);
+
+	// Records the copies out of an allocation, after which the batch is free to be submitted again
+	// Null if the allocation went unused, it still has to be committed
+	EXPORT void commit(const SAllocation& inAllocation, FRecordCopy inRecord);
+
+	// Records commands that don't need staging memory, like layout transitions
+	EXPORT void record(FRecord inRecord);
+
+	// Uploads a mip level of an image that is already in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	EXPORT void uploadToImage(const TFrail<SVRIImage>& inImage, const void* inData, size_t inSize, uint32 inMipLevel, VkExtent3D inExtent);
+
+	// Submits the batch and waits for it
+	EXPORT void flush();
+
+	EXPORT SStats getStats() const;
+
+private:
+
+	void flush(std::unique_lock<std::mutex>& inLock);
+
+	TFrail<CRenderer> m_Renderer;
+
+	TUnique<SVRIBuffer> m_Staging = nullptr;
+
+	size_t m_Capacity;
+
+	size_t m_Used = 0;
+
+	// Allocations handed out but not committed yet
+	uint32 m_Outstanding = 0;
+
+	// Set while a full batch waits for outstanding allocations, so no new ones start in the meantime
+	bool m_Flushing = false;
+
+	std::vector<FRecord> m_Commands;
+
+	SStats m_Stats;
+
+	mutable std::mutex m_Mutex;
+
+	std::condition_variable m_Committed;
+
+};
@@ -1,5 +1,10 @@
 ﻿#include "rendercore/EngineLoader.h"
 
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <set>
+
 #include <fastgltf/glm_element_traits.hpp>
 #include <fastgltf/tools.hpp>
 #include <fastgltf/core.hpp>
@@ -16,12 +21,19 @@
 #include "encoder/basisu_gpu_texture.h"
 #include "rendercore/Font.h"
 
+#include "basic/core/DerivedDataCache.h"
+#include "basic/core/Threading.h"
 #include "rendercore/StaticMesh.h"
+#include "rendercore/UploadBatcher.h"
 #include "rendercore/VulkanUtils.h"
 
 constexpr static bool gUseOpenCL = false;
 
-TShared<SVRIImage> loadImage(const TFrail<CRenderer>& renderer, const std::filesystem::path& path) {
+// Part of every derived data key, bump when an importer's output changes so old cooked data is ignored
+constexpr static uint32 gTextureCookVersion = 1;
+constexpr static uint32 gMeshCookVersion = 3;
+
+TShared<SVRIImage> loadImage(CUploadBatcher& batcher, const std::filesystem::path& path) {
 	const std::string& fileName = path.filename().string();
 
 	basisu::uint8_vec fileData;
@@ -44,90 +56,107 @@ TShared<SVRIImage> loadImage(const TFrail<CRenderer>& renderer, const std::files
 
 	msgs("Texture dimensions: ({}x{}), levels: {}", width, height, numMips);
 
-	// Allocate image and transition to dst
-	TShared<SVRIImage> image{fileName, imageSize, VK_FORMAT_BC7_SRGB_BLOCK, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, numMips};
-
-	renderer->immediateSubmit([&](const TFrail<CVRICommands>& cmd) {
-		cmd->transitionImage(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	});
-
 	transcoder.start_transcoding();
 
-	// Transcode each mipmap and add to vector
+	// Transcoding is most of the work, so every level is transcoded before creating the image
+	std::vector<basisu::gpu_image> levels;
+	levels.reserve(numMips);
 	for (uint32 mipmap = 0; mipmap < numMips; ++mipmap) {
 		const auto level_width = basisu::maximum<uint32>(width >> mipmap, 1);
 		const auto level_height = basisu::maximum<uint32>(height >> mipmap, 1);
-		basisu::gpu_image tex(basisu::texture_format::cBC7, level_width, level_height); //cDecodeFlagsTranscodeAlphaDataToOpaqueFormats
+		basisu::gpu_image& tex = levels.emplace_back(basisu::texture_format::cBC7, level_width, level_height); //cDecodeFlagsTranscodeAlphaDataToOpaqueFormats
 
 		if (const bool status = transcoder.transcode_image_level(mipmap, 0, 0, tex.get_ptr(), tex.get_total_blocks(), basist::transcoder_texture_format::cTFBC7_RGBA, 0); !status) {
 			errs("Image Transcode for file {} failed.", fileName.c_str());
 		}
+	}
+
+	// Allocate image
+	TShared<SVRIImage> image = nullptr;
+	{
+		std::lock_guard lock(CUploadBatcher::getResourceMutex());
+		image = TShared<SVRIImage>{fileName, imageSize, VK_FORMAT_BC7_SRGB_BLOCK, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, numMips};
+	}
+
+	// The commands run when the batch is submitted, so they hold on to the image instead of referencing it
+	batcher.record([image](const TFrail<CVRICommands>& cmd) {
+		cmd->transitionImage(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	});
 
-		const void* pImage = tex.get_ptr();
-		const uint32 image_size = tex.get_size_in_bytes();
+	// Upload each mipmap
+	for (uint32 mipmap = 0; mipmap < numMips; ++mipmap) {
+		basisu::gpu_image& tex = levels[mipmap];
 
 		VkExtent3D levelSize;
-		levelSize.width = level_width;
-		levelSize.height = level_height;
+		levelSize.width = basisu::maximum<uint32>(width >> mipmap, 1);
+		levelSize.height = basisu::maximum<uint32>(height >> mipmap, 1);
 		levelSize.depth = 1;
 
-		// Upload buffer is not needed outside of this function
-
-		SStagingBuffer uploadBuffer{"Staging for " + fileName, image_size}; //TODO: was CPU_TO_GPU, test if errors
+		batcher.uploadToImage(image, tex.get_ptr(), tex.get_size_in_bytes(), mipmap, levelSize);
+	}
 
-		uploadBuffer.push(pImage, image_size);
+	batcher.record([image](const TFrail<CVRICommands>& cmd) {
+		cmd->transitionImage(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	});
 
-		renderer->immediateSubmit([&](const TFrail<CVRICommands>& cmd) {
-			//ZoneScopedAllocation(std::string("Copy Image from Upload Buffer"));
+	return image;
+}
 
-			const VkBufferImageCopy copyRegion = {
-				.bufferOffset = 0,
-				.bufferRowLength = 0,
-				.bufferImageHeight = 0,
-				.imageSubresource = {
-					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-					.mipLevel = mipmap,
-					.baseArrayLayer = 0,
-					.layerCount = 1
-				},
-				.imageOffset = {},
-				.imageExtent = levelSize
-			};
+// R8 atlases are a single level, so they go through the batcher like any other image
+static void uploadAtlas(CUploadBatcher& batcher, SFont& font, const std::span<const uint8> atlasData) {
+	{
+		std::lock_guard lock(CUploadBatcher::getResourceMutex());
 
-			// copy the buffer into the image
-			cmd->copyBufferToImage(uploadBuffer.get(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, copyRegion);
-		});
+		const std::string label = font.mName + " Atlas";
+		font.mAtlasImage = TUnique<SVRIImage>{label, VkExtent3D{font.mAtlasSize.x, font.mAtlasSize.y, 1}, VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
 	}
 
-	renderer->immediateSubmit([&](const TFrail<CVRICommands>& cmd) {
-		cmd->transitionImage(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	// The font is moved into the asset map before the batch is submitted, but the image it points to stays put
+	const TFrail<SVRIImage> image = font.mAtlasImage;
+
+	batcher.record([image](const TFrail<CVRICommands>& cmd) {
+		cmd->transitionImage(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 	});
 
-	return image;
+	batcher.uploadToImage(image, atlasData.data(), atlasData.size(), 0, image->getExtent());
+
+	batcher.record([image](const TFrail<CVRICommands>& cmd) {
+		cmd->transitionImage(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	});
 }
 
-SFont loadFont(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath) {
+SFont loadFont(CUploadBatcher& batcher, const std::filesystem::path& inPath) {
 	SFont font;
-	std::vector<uint8> atlasData;
 
-	CFileArchive file(inPath.string(), "rb");
-	file >> font;
-	file >> atlasData;
-	file.close();
+	CChunkReader reader(inPath.string());
 
-	const std::string label = font.mName + " Atlas";
-	font.mAtlasImage = TUnique<SVRIImage>{label, VkExtent3D{font.mAtlasSize.x, font.mAtlasSize.y, 1}, VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
+	// The atlas goes from the mapping straight into the batch's staging buffer
+	std::span<const uint8> atlasData;
+	if (reader.isChunkFile()) {
+		if (!reader.read(CEngineLoader::mFontChunk, font)) {
+			msgs("Could not read font {}!", inPath.string());
+			return font;
+		}
+		atlasData = reader.getChunkData(CEngineLoader::mFontAtlasChunk);
+	} else {
+		CMappedArchive& file = reader.getArchive();
+		file >> font;
+		atlasData = file.viewVector<uint8>();
+	}
 
-	renderer->immediateSubmit([&](const TFrail<CVRICommands>& cmd) {
-		font.mAtlasImage->push(cmd, atlasData.data(), atlasData.size());
-	});
+	if (atlasData.size() != static_cast<size_t>(font.mAtlasSize.x) * font.mAtlasSize.y) {
+		msgs("Font {} has a missing or damaged atlas!", inPath.string());
+		return font;
+	}
+
+	uploadAtlas(batcher, font, atlasData);
 
 	return font;
 }
 
 using MeshData = std::vector<std::pair<std::string, std::shared_ptr<SMeshData>>>;
 
-void optimizeMesh(std::vector<uint32>& indices, std::vector<SVertex>& vertices) {
+void optimizeMesh(std::vector<uint32>& indices, std::vector<SVertex>& vertices, const std::vector<SMeshData::Surface>& surfaces) {
 	const size_t numIndices = indices.size();
 	const size_t numVertices = vertices.size();
 
@@ -144,8 +173,11 @@ void optimizeMesh(std::vector<uint32>& indices, std::vector<SVertex>& vertices)
 	meshopt_remapIndexBuffer(optimizedIndices.data(), indices.data(), numIndices, remap.data());
 	meshopt_remapVertexBuffer(optimizedVertices.data(), vertices.data(), numVertices, sizeof(SVertex), remap.data());
 
-	// Optimize cache
-	meshopt_optimizeVertexCache(optimizedIndices.data(), optimizedIndices.data(), numIndices, optimizedVertexCount);
+	// Optimize cache, each surface on its own since triangles can't move between surfaces
+	for (const SMeshData::Surface& surface : surfaces) {
+		uint32* surfaceIndices = optimizedIndices.data() + surface.startIndex;
+		meshopt_optimizeVertexCache(surfaceIndices, surfaceIndices, surface.count, optimizedVertexCount);
+	}
 
 	// reduce overdraw TODO: positions probably wont work
 	//meshopt_optimizeOverdraw(optimizedIndices.data(), optimizedIndices.data(), numIndices, &(optimizedVertices[0].position.x), optimizedVertexCount, sizeof(SVertex), 1.05f);
@@ -153,14 +185,7 @@ void optimizeMesh(std::vector<uint32>& indices, std::vector<SVertex>& vertices)
 	// optimize access
 	meshopt_optimizeVertexFetch(optimizedVertices.data(), optimizedIndices.data(), numIndices, optimizedVertices.data(), optimizedVertexCount, sizeof(SVertex));
 
-	// TODO: simplify mesh?
-	/*constexpr float Threshold = 0.5f;
-	size_t TargetIndexCount = (size_t)(numIndices * Threshold);
-	float TargetError = 0.2f;
-	std::vector<uint32> SimplifiedIndices(optimizedIndices.size());
-	size_t optimizedIndexCount = meshopt_simplify(SimplifiedIndices.data(), optimizedIndices.data(), numIndices, &optimizedVertices[0].position.x, optimizedVertexCount, sizeof(SVertex), TargetIndexCount, TargetError);
-
-	SimplifiedIndices.resize(optimizedIndexCount);*/
+	// Simplifying is done separately, see SMeshData::buildLods
 
 	indices = optimizedIndices;
 	vertices = optimizedVertices;
@@ -342,19 +367,19 @@ MeshData loadGLTF_Internal(std::filesystem::path path) {
 			return {};
 		}
 
-		optimizeMesh(indices, vertices);
+		optimizeMesh(indices, vertices, outMesh->surfaces);
 
-		Vector3f minpos(std::numeric_limits<float>::max());
-		Vector3f maxpos(std::numeric_limits<float>::min());
+		using MinMax = std::pair<Vector3f, Vector3f>;
 
-		for (auto& vertex : vertices) {
-			minpos.x = glm::min(minpos.x, vertex.position.x);
-			minpos.y = glm::min(minpos.y, vertex.position.y);
-			minpos.z = glm::min(minpos.z, vertex.position.z);
-			maxpos.x = glm::max(maxpos.x, vertex.position.x);
-			maxpos.y = glm::max(maxpos.y, vertex.position.y);
-			maxpos.z = glm::max(maxpos.z, vertex.position.z);
-		}
+		// Scanned meshes can have millions of vertices, so the min/max is split across threads
+		const auto [minpos, maxpos] = CThreading::parallelReduce(vertices, 16384,
+			MinMax{Vector3f(std::numeric_limits<float>::max()), Vector3f(std::numeric_limits<float>::lowest())},
+			[](const SVertex& vertex) -> MinMax {
+				return {vertex.position, vertex.position};
+			},
+			[](const MinMax& lhs, const MinMax& rhs) -> MinMax {
+				return {glm::min(lhs.first, rhs.first), glm::max(lhs.second, rhs.second)};
+			});
 
 		// Calculate origin and extents from the min/max, use extent length for radius
 		outMesh->bounds.origin = (maxpos + minpos) / 2.f;
@@ -370,62 +395,386 @@ MeshData loadGLTF_Internal(std::filesystem::path path) {
 	return savedMeshes;
 }
 
+// 16 bit positions and octahedral normals, padded so the stride stays a multiple of 4 for meshopt
+struct SQuantizedVertex {
+	uint16 mPosition[3];
+	int16 mNormal[2];
+	uint16 mPadding;
+	uint32 mUV;
+	uint32 mColor;
+};
+
+static_assert(sizeof(SQuantizedVertex) == 20, "Quantized vertices are encoded as is, so they can't have padding.");
+
+// Projects onto an octahedron and unfolds it into a square, which spreads precision evenly over the sphere
+static void encodeOctahedral(const Vector3f& inNormal, int16 (&outNormal)[2]) {
+	const float length = std::abs(inNormal.x) + std::abs(inNormal.y) + std::abs(inNormal.z);
+	Vector2f octahedral = length > 0.f ? Vector2f{inNormal.x, inNormal.y} / length : Vector2f{0.f};
+
+	// The lower half folds out over the diagonals
+	if (inNormal.z < 0.f) {
+		const Vector2f sign{octahedral.x >= 0.f ? 1.f : -1.f, octahedral.y >= 0.f ? 1.f : -1.f};
+		octahedral = (1.f - glm::abs(Vector2f{octahedral.y, octahedral.x})) * sign;
+	}
+
+	outNormal[0] = static_cast<int16>(std::round(glm::clamp(octahedral.x, -1.f, 1.f) * 32767.f));
+	outNormal[1] = static_cast<int16>(std::round(glm::clamp(octahedral.y, -1.f, 1.f) * 32767.f));
+}
+
+static Vector3f decodeOctahedral(const int16 (&inNormal)[2]) {
+	Vector3f normal{inNormal[0] / 32767.f, inNormal[1] / 32767.f, 0.f};
+	normal.z = 1.f - std::abs(normal.x) - std::abs(normal.y);
+
+	const float fold = std::max(-normal.z, 0.f);
+	normal.x += normal.x >= 0.f ? -fold : fold;
+	normal.y += normal.y >= 0.f ? -fold : fold;
+	return glm::normalize(normal);
+}
+
+// A level has to drop at least this much of the previous level's triangles to be kept
+constexpr static float gMinLodReduction = 0.1f;
+
+void SMeshData::buildLods(const SLodSettings& inSettings) {
+	lods.clear();
+	if (vertices.empty() || bounds.sphereRadius <= 0.f) return;
+
+	// meshopt's errors are relative to the mesh's extents, lods keep them relative to the bounding sphere
+	const float errorScale = meshopt_simplifyScale(&vertices[0].position.x, vertices.size(), sizeof(SVertex)) / bounds.sphereRadius;
+
+	const uint32 lodCount = std::min(inSettings.mLodCount, SStaticMesh::mMaxLods);
+	size_t previousCount = indices.size();
+	float targetRatio = 1.f;
+	std::vector<uint32> simplified;
+
+	for (uint32 level = 1; level < lodCount; ++level) {
+		targetRatio *= inSettings.mReduction;
+
+		// Every level is simplified from the full detail indices, so errors don't build up from one level to the next
+		SMeshLod lod{.mError = lods.empty() ? 0.f : lods.back().mError};
+		std::vector<uint32> levelIndices;
+		for (const Surface& surface : surfaces) {
+			const size_t targetCount = static_cast<size_t>(surface.count * targetRatio) / 3 * 3;
+
+			simplified.resize(surface.count);
+			float error = 0.f;
+			simplified.resize(meshopt_simplify(simplified.data(), indices.data() + surface.startIndex, surface.count, &vertices[0].position.x, vertices.size(), sizeof(SVertex), targetCount, inSettings.mMaxError, 0, &error));
+			meshopt_optimizeVertexCache(simplified.data(), simplified.data(), simplified.size(), vertices.size());
+
+			lod.mSurfaces.push_back({
+				.mStartIndex = static_cast<uint32>(indices.size() + levelIndices.size()),
+				.mCount = static_cast<uint32>(simplified.size())
+			});
+			levelIndices.append_range(simplified);
+			lod.mError = std::max(lod.mError, error * errorScale);
+		}
+
+		// Anything further would be just as large, since the error is what is stopping it
+		if (levelIndices.size() > previousCount * (1.f - gMinLodReduction)) break;
+
+		previousCount = levelIndices.size();
+		indices.append_range(levelIndices);
+		lods.push_back(std::move(lod));
+
+		if (levelIndices.empty()) break;
+	}
+}
+
+// Sizes meshopt suggests, small enough that a cluster's triangles mostly face the same way
+constexpr static size_t gMeshletMaxVertices = 64;
+constexpr static size_t gMeshletMaxTriangles = 124;
+constexpr static float gMeshletConeWeight = 0.25f;
+
+void SMeshData::buildMeshlets() {
+	meshlets.clear();
+	if (vertices.empty()) return;
+
+	for (uint32 surfaceIndex = 0; surfaceIndex < surfaces.size(); ++surfaceIndex) {
+		const Surface& surface = surfaces[surfaceIndex];
+
+		const size_t maxMeshlets = meshopt_buildMeshletsBound(surface.count, gMeshletMaxVertices, gMeshletMaxTriangles);
+		std::vector<meshopt_Meshlet> built(maxMeshlets);
+		std::vector<uint32> meshletVertices(maxMeshlets * gMeshletMaxVertices);
+		std::vector<uint8> meshletTriangles(maxMeshlets * gMeshletMaxTriangles * 3);
+		built.resize(meshopt_buildMeshlets(built.data(), meshletVertices.data(), meshletTriangles.data(), indices.data() + surface.startIndex, surface.count, &vertices[0].position.x, vertices.size(), sizeof(SVertex), gMeshletMaxVertices, gMeshletMaxTriangles, gMeshletConeWeight));
+
+		// The meshlets hold every triangle, so the surface's indices can be written back over in meshlet order
+		uint32 index = surface.startIndex;
+		for (const meshopt_Meshlet& meshlet : built) {
+			const meshopt_Bounds meshletBounds = meshopt_computeMeshletBounds(&meshletVertices[meshlet.vertex_offset], &meshletTriangles[meshlet.triangle_offset], meshlet.triangle_count, &vertices[0].position.x, vertices.size(), sizeof(SVertex));
+
+			meshlets.push_back({
+				.mCenter = Vector3f{meshletBounds.center[0], meshletBounds.center[1], meshletBounds.center[2]},
+				.mRadius = meshletBounds.radius,
+				.mConeApex = Vector3f{meshletBounds.cone_apex[0], meshletBounds.cone_apex[1], meshletBounds.cone_apex[2]},
+				.mConeCutoff = meshletBounds.cone_cutoff,
+				.mConeAxis = Vector3f{meshletBounds.cone_axis[0], meshletBounds.cone_axis[1], meshletBounds.cone_axis[2]},
+				.mStartIndex = index,
+				.mCount = meshlet.triangle_count * 3,
+				.mSurface = surfaceIndex
+			});
+
+			for (uint32 i = 0; i < meshlet.triangle_count * 3; ++i) {
+				indices[index++] = meshletVertices[meshlet.vertex_offset + meshletTriangles[meshlet.triangle_offset + i]];
+			}
+		}
+
+		asts(index == surface.startIndex + surface.count, "Meshlets of surface {} cover {} indices instead of {}.", surface.name, index - surface.startIndex, surface.count);
+	}
+}
+
+static std::vector<uint8> encodeVertexBuffer(const void* inVertices, const size_t inCount, const size_t inStride) {
+	std::vector<uint8> encoded(meshopt_encodeVertexBufferBound(inCount, inStride));
+	encoded.resize(meshopt_encodeVertexBuffer(encoded.data(), encoded.size(), inVertices, inCount, inStride));
+	return encoded;
+}
+
+void SMeshData::saveChunks(CChunkWriter& inWriter, const EVertexEncoding inEncoding) const {
+	SVertexChunkHeader vertexHeader{
+		.mCount = vertices.size(),
+		.mEncoding = inEncoding,
+		.mHasVertexColor = mHasVertexColor
+	};
+
+	// Color is always stored, meshopt encodes a constant attribute to almost nothing
+	std::vector<uint8> encodedVertices;
+	if (inEncoding == EVertexEncoding::QUANTIZED) {
+		Vector3f min{std::numeric_limits<float>::max()};
+		Vector3f max{std::numeric_limits<float>::lowest()};
+		for (const SVertex& vertex : vertices) {
+			min = glm::min(min, vertex.position);
+			max = glm::max(max, vertex.position);
+		}
+
+		vertexHeader.mPositionOrigin = vertices.empty() ? Vector3f{0.f} : min;
+		vertexHeader.mPositionScale = vertices.empty() ? Vector3f{0.f} : (max - min) / 65535.f;
+
+		// Flat axes have no range, so everything on them quantizes to 0
+		const Vector3f inverseScale = glm::mix(Vector3f{0.f}, 1.f / vertexHeader.mPositionScale, glm::greaterThan(vertexHeader.mPositionScale, Vector3f{0.f}));
+
+		std::vector<SQuantizedVertex> quantized(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			const SVertex& vertex = vertices[i];
+			const Vector3f position = glm::clamp(glm::round((vertex.position - min) * inverseScale), 0.f, 65535.f);
+
+			quantized[i] = {
+				.mPosition = {static_cast<uint16>(position.x), static_cast<uint16>(position.y), static_cast<uint16>(position.z)},
+				.mPadding = 0,
+				.mUV = vertex.uv,
+				.mColor = vertex.color
+			};
+			encodeOctahedral(vertex.normal, quantized[i].mNormal);
+		}
+
+		encodedVertices = encodeVertexBuffer(quantized.data(), quantized.size(), sizeof(SQuantizedVertex));
+	} else {
+		encodedVertices = encodeVertexBuffer(vertices.data(), vertices.size(), sizeof(SVertex));
+	}
+
+	CMemoryArchive& vertexChunk = inWriter.addChunk(mVertexChunk, mEncodedChunkVersion);
+	vertexChunk.writeSpan(&vertexHeader, 1);
+	vertexChunk.writeSpan(encodedVertices.data(), encodedVertices.size());
+
+	// The index codec works on whole triangles
+	asts(indices.size() % 3 == 0, "Mesh has {} indices, which isn't a triangle list.", indices.size());
+
+	const SIndexChunkHeader indexHeader{
+		.mCount = indices.size()
+	};
+
+	std::vector<uint8> encodedIndices(meshopt_encodeIndexBufferBound(indices.size(), vertices.size()));
+	encodedIndices.resize(meshopt_encodeIndexBuffer(encodedIndices.data(), encodedIndices.size(), indices.data(), indices.size()));
+
+	CMemoryArchive& indexChunk = inWriter.addChunk(mIndexChunk, mEncodedChunkVersion);
+	indexChunk.writeSpan(&indexHeader, 1);
+	indexChunk.writeSpan(encodedIndices.data(), encodedIndices.size());
+
+	inWriter.addChunk(mSurfaceChunk, 1, surfaces);
+	inWriter.addChunk(mBoundsChunk, 1, bounds);
+
+	if (!lods.empty()) {
+		inWriter.addChunk(mLodChunk, 1, lods);
+	}
+
+	if (!meshlets.empty()) {
+		inWriter.addChunk(mMeshletChunk, 1, meshlets);
+	}
+}
+
+bool SMeshData::loadChunks(CChunkReader& inReader) {
+	if (inReader.getVersion(mVertexChunk) >= mEncodedChunkVersion) {
+		SEncoded encoded;
+		if (!encoded.read(inReader)) return false;
+
+		mHasVertexColor = encoded.mVertexHeader.mHasVertexColor != 0;
+		vertices.resize(encoded.mVertexHeader.mCount);
+		indices.resize(encoded.mIndexHeader.mCount);
+		if (!encoded.decodeVertices(vertices) || !encoded.decodeIndices(indices)) return false;
+	} else {
+		CArchive* vertexChunk = inReader.openChunk(mVertexChunk);
+		if (!vertexChunk) return false;
+		*vertexChunk >> mHasVertexColor;
+		loadVertices(*vertexChunk);
+
+		CArchive* indexChunk = inReader.openChunk(mIndexChunk);
+		if (!indexChunk) return false;
+		loadIndices(*indexChunk);
+	}
+
+	return inReader.read(mSurfaceChunk, surfaces) && inReader.read(mBoundsChunk, bounds)
+		&& (!inReader.has(mLodChunk) || inReader.read(mLodChunk, lods))
+		&& (!inReader.has(mMeshletChunk) || inReader.read(mMeshletChunk, meshlets));
+}
+
+bool SMeshData::SEncoded::read(CChunkReader& inReader) {
+	if (inReader.getVersion(mVertexChunk) != mEncodedChunkVersion || inReader.getVersion(mIndexChunk) != mEncodedChunkVersion) return false;
+
+	const std::span<const uint8> vertexChunk = inReader.getChunkData(mVertexChunk);
+	const std::span<const uint8> indexChunk = inReader.getChunkData(mIndexChunk);
+	if (vertexChunk.size() < sizeof(SVertexChunkHeader) || indexChunk.size() < sizeof(SIndexChunkHeader)) return false;
+
+	memcpy(&mVertexHeader, vertexChunk.data(), sizeof(SVertexChunkHeader));
+	memcpy(&mIndexHeader, indexChunk.data(), sizeof(SIndexChunkHeader));
+	mVertexData = vertexChunk.subspan(sizeof(SVertexChunkHeader));
+	mIndexData = indexChunk.subspan(sizeof(SIndexChunkHeader));
+	return true;
+}
+
+bool SMeshData::SEncoded::decodeVertices(const std::span<SVertex> outVertices) const {
+	if (outVertices.size() != mVertexHeader.mCount) return false;
+
+	switch (mVertexHeader.mEncoding) {
+		case EVertexEncoding::LOSSLESS:
+			return meshopt_decodeVertexBuffer(outVertices.data(), outVertices.size(), sizeof(SVertex), mVertexData.data(), mVertexData.size()) == 0;
+		case EVertexEncoding::QUANTIZED: {
+			std::vector<SQuantizedVertex> quantized(outVertices.size());
+			if (meshopt_decodeVertexBuffer(quantized.data(), quantized.size(), sizeof(SQuantizedVertex), mVertexData.data(), mVertexData.size()) != 0) return false;
+
+			// Each vertex is written once, in order, so this is fine to run on mapped memory
+			CThreading::parallelFor(0, quantized.size(), 16384, [&](const size_t inIndex) {
+				const SQuantizedVertex& vertex = quantized[inIndex];
+				const Vector3f position{vertex.mPosition[0], vertex.mPosition[1], vertex.mPosition[2]};
+
+				SVertex decoded;
+				decoded.position = mVertexHeader.mPositionOrigin + position * mVertexHeader.mPositionScale;
+				decoded.uv = vertex.mUV;
+				decoded.normal = decodeOctahedral(vertex.mNormal);
+				decoded.color = vertex.mColor;
+				outVertices[inIndex] = decoded;
+			});
+			return true;
+		}
+	}
+
+	msgs("Unknown vertex encoding {}.", static_cast<uint32>(mVertexHeader.mEncoding));
+	return false;
+}
+
+bool SMeshData::SEncoded::decodeIndices(const std::span<uint32> outIndices) const {
+	if (outIndices.size() != mIndexHeader.mCount) return false;
+
+	return meshopt_decodeIndexBuffer(outIndices.data(), outIndices.size(), sizeof(uint32), mIndexData.data(), mIndexData.size()) == 0;
+}
+
 SMeshData readMeshData(const std::filesystem::path& path) {
-	CFileArchive file(path.string(), "rb");
+	CChunkReader reader(path.string());
 
-	if (!file.isOpen()) {
+	if (!reader.isOpen()) {
 		msgs("Could not open Mesh file {}!", path.string().c_str());
 		return {};
 	}
 
 	SMeshData outSaveData;
 
-	file >> outSaveData;
+	if (!reader.isChunkFile()) {
+		reader.getArchive() >> outSaveData;
+		return outSaveData;
+	}
 
-	file.close();
+	// Vertices and indices are the bulk of the file, so they are decompressed side by side
+	reader.decompressAll();
+
+	if (!outSaveData.loadChunks(reader)) {
+		msgs("Mesh file {} is missing chunks!", path.string().c_str());
+		return {};
+	}
 
 	return outSaveData;
 }
 
-TUnique<SVRIMeshBuffer> uploadMesh(const TFrail<CRenderer>& renderer,  std::span<uint32> indices, std::span<SVertex> vertices) {
-	const size_t vertexBufferSize = vertices.size() * sizeof(SVertex);
-	const size_t indexBufferSize = indices.size() * sizeof(uint32);
+bool CEngineLoader::readMeshBounds(const std::filesystem::path& inPath, SBounds& outBounds) {
+	CChunkReader reader(inPath.string());
 
-	// Create buffers
-	TUnique<SVRIMeshBuffer> meshBuffers{indexBufferSize, vertexBufferSize};
-
-	// Staging is not needed outside of this function
-	SStagingBuffer staging{"Staging for Mesh Buffer", vertexBufferSize + indexBufferSize};
+	// Older files have the bounds at the very end, so the whole mesh has to be read anyway
+	if (!reader.isChunkFile()) {
+		if (!reader.isOpen()) return false;
+		SMeshData data;
+		reader.getArchive() >> data;
+		outBounds = data.bounds;
+		return true;
+	}
 
-	// Copy vertex and Index Buffer
-	staging.push(vertices.data(), vertexBufferSize, indices.data(), indexBufferSize);
+	return reader.read(SMeshData::mBoundsChunk, outBounds);
+}
 
-	//TODO: slow, render thread?
-	// also from an older version of the tutorial, doesnt use sync2
-	renderer->immediateSubmit([&](const TFrail<CVRICommands>& cmd) {
+// The allocation holds the vertices followed by the indices
+void commitMeshAllocation(CUploadBatcher& batcher, const CUploadBatcher::SAllocation& allocation, const TUnique<SVRIMeshBuffer>& meshBuffers, const size_t vertexBufferSize, const size_t indexBufferSize) {
+	batcher.commit(allocation, [vertexBuffer = meshBuffers->vertexBuffer->buffer, indexBuffer = meshBuffers->indexBuffer->buffer, vertexBufferSize, indexBufferSize](const TFrail<CVRICommands>& cmd, const TFrail<SVRIBuffer>& staging, const size_t offset) {
 		VkBufferCopy vertexCopy{};
 		vertexCopy.dstOffset = 0;
-		vertexCopy.srcOffset = 0;
+		vertexCopy.srcOffset = offset;
 		vertexCopy.size = vertexBufferSize;
 
-		cmd->copyBuffer(staging.get()->buffer, meshBuffers->vertexBuffer->buffer, 1, vertexCopy);
+		cmd->copyBuffer(staging->buffer, vertexBuffer, 1, vertexCopy);
 
 		VkBufferCopy indexCopy{};
 		indexCopy.dstOffset = 0;
-		indexCopy.srcOffset = vertexBufferSize;
+		indexCopy.srcOffset = offset + vertexBufferSize;
 		indexCopy.size = indexBufferSize;
 
-		cmd->copyBuffer(staging.get()->buffer, meshBuffers->indexBuffer->buffer, 1, indexCopy);
+		cmd->copyBuffer(staging->buffer, indexBuffer, 1, indexCopy);
 	});
+}
+
+TUnique<SVRIMeshBuffer> createMeshBuffers(const size_t vertexBufferSize, const size_t indexBufferSize) {
+	std::lock_guard lock(CUploadBatcher::getResourceMutex());
+	return TUnique<SVRIMeshBuffer>{indexBufferSize, vertexBufferSize};
+}
+
+TUnique<SVRIMeshBuffer> uploadMesh(CUploadBatcher& batcher, std::span<uint32> indices, std::span<SVertex> vertices) {
+	const size_t vertexBufferSize = vertices.size() * sizeof(SVertex);
+	const size_t indexBufferSize = indices.size() * sizeof(uint32);
+
+	TUnique<SVRIMeshBuffer> meshBuffers = createMeshBuffers(vertexBufferSize, indexBufferSize);
+
+	// Copy vertex and Index Buffer
+	const CUploadBatcher::SAllocation allocation = batcher.allocate(vertexBufferSize + indexBufferSize);
+	memcpy(allocation.mData.data(), vertices.data(), vertexBufferSize);
+	memcpy(allocation.mData.data() + vertexBufferSize, indices.data(), indexBufferSize);
+
+	commitMeshAllocation(batcher, allocation, meshBuffers, vertexBufferSize, indexBufferSize);
 
 	return meshBuffers;
 }
 
-TShared<SStaticMesh> toStaticMesh(const TFrail<CRenderer>& renderer, SMeshData mesh, const std::string& fileName) {
+TShared<SStaticMesh> createStaticMesh(const std::string& fileName, const SBounds& bounds, const std::vector<SMeshData::Surface>& surfaces, std::vector<SMeshLod> lods, std::vector<SMeshlet> meshlets) {
 	TShared<SStaticMesh> loadMesh{};
 	loadMesh->name = fileName;
-	loadMesh->bounds = mesh.bounds;
-	for (auto& [name, startIndex, count] : mesh.surfaces) {
+	loadMesh->bounds = bounds;
+
+	// The renderer can only group instances into so many levels, and a level that doesn't cover every surface can't be drawn
+	std::erase_if(lods, [&](const SMeshLod& lod) { return lod.mSurfaces.size() != surfaces.size(); });
+	if (lods.size() >= SStaticMesh::mMaxLods) lods.resize(SStaticMesh::mMaxLods - 1);
+	loadMesh->lods = std::move(lods);
+
+	// Meshlets have to stay inside of their surface, otherwise the mesh is drawn a whole surface at a time
+	const bool validMeshlets = std::ranges::all_of(meshlets, [&](const SMeshlet& meshlet) {
+		return meshlet.mSurface < surfaces.size()
+			&& meshlet.mStartIndex >= surfaces[meshlet.mSurface].startIndex
+			&& meshlet.mStartIndex + meshlet.mCount <= surfaces[meshlet.mSurface].startIndex + surfaces[meshlet.mSurface].count;
+	});
+	if (validMeshlets) loadMesh->meshlets = std::move(meshlets);
+
+	for (auto& [name, startIndex, count] : surfaces) {
 		loadMesh->surfaces.push_back({
 			.name = name,
 			.material = nullptr,
@@ -433,16 +782,163 @@ TShared<SStaticMesh> toStaticMesh(const TFrail<CRenderer>& renderer, SMeshData m
 			.count = count
 		});
 	}
+	return loadMesh;
+}
 
-	loadMesh->meshBuffers = uploadMesh(renderer, mesh.indices, mesh.vertices);
+TShared<SStaticMesh> toStaticMesh(CUploadBatcher& batcher, SMeshData mesh, const std::string& fileName) {
+	TShared<SStaticMesh> loadMesh = createStaticMesh(fileName, mesh.bounds, mesh.surfaces, std::move(mesh.lods), std::move(mesh.meshlets));
+	loadMesh->meshBuffers = uploadMesh(batcher, mesh.indices, mesh.vertices);
 	return loadMesh;
 }
 
+// Encoded indices are decoded straight into the staging buffer, vertices are decoded before allocating since quantized ones go wide
+// Older files are read into SMeshData and copied in like before
+TShared<SStaticMesh> loadMesh(CUploadBatcher& batcher, const std::filesystem::path& path, const std::string& fileName) {
+	CChunkReader reader(path.string());
+
+	if (!reader.isChunkFile() || reader.getVersion(SMeshData::mVertexChunk) < SMeshData::mEncodedChunkVersion) {
+		return toStaticMesh(batcher, readMeshData(path), fileName);
+	}
+
+	// Meshopt output usually still compresses, so the chunks are decompressed side by side first
+	reader.decompressAll();
+
+	SMeshData::SEncoded encoded;
+	std::vector<SMeshData::Surface> surfaces;
+	std::vector<SMeshLod> lods;
+	std::vector<SMeshlet> meshlets;
+	SBounds bounds;
+	if (!encoded.read(reader) || !reader.read(SMeshData::mSurfaceChunk, surfaces) || !reader.read(SMeshData::mBoundsChunk, bounds)) {
+		msgs("Mesh file {} is missing chunks!", path.string().c_str());
+		return nullptr;
+	}
+
+	// Only the full detail level is drawn if this is damaged, which is better than no mesh at all
+	if (reader.has(SMeshData::mLodChunk) && !reader.read(SMeshData::mLodChunk, lods)) {
+		msgs("Mesh file {} has damaged lods!", path.string().c_str());
+		lods.clear();
+	}
+
+	if (reader.has(SMeshData::mMeshletChunk) && !reader.read(SMeshData::mMeshletChunk, meshlets)) {
+		msgs("Mesh file {} has damaged meshlets!", path.string().c_str());
+		meshlets.clear();
+	}
+
+	// Decoding quantized vertices runs a parallel for, whose wait can pick up another load sharing this batcher
+	// That load would allocate while this thread still holds an allocation, so nothing parallel runs between allocate and commit
+	std::vector<SVertex> vertices(encoded.mVertexHeader.mCount);
+	if (!encoded.decodeVertices(vertices)) {
+		msgs("Mesh file {} could not be decoded!", path.string().c_str());
+		return nullptr;
+	}
+
+	const size_t vertexBufferSize = encoded.mVertexHeader.mCount * sizeof(SVertex);
+	const size_t indexBufferSize = encoded.mIndexHeader.mCount * sizeof(uint32);
+
+	const CUploadBatcher::SAllocation allocation = batcher.allocate(vertexBufferSize + indexBufferSize);
+	memcpy(allocation.mData.data(), vertices.data(), vertexBufferSize);
+	const std::span indices{reinterpret_cast<uint32*>(allocation.mData.data() + vertexBufferSize), encoded.mIndexHeader.mCount};
+
+	if (!encoded.decodeIndices(indices)) {
+		msgs("Mesh file {} could not be decoded!", path.string().c_str());
+		// A batch waits on every allocation, so this one is still committed, just without a copy
+		batcher.commit(allocation, nullptr);
+		return nullptr;
+	}
+
+	TShared<SStaticMesh> mesh = createStaticMesh(fileName, bounds, surfaces, std::move(lods), std::move(meshlets));
+	mesh->meshBuffers = createMeshBuffers(vertexBufferSize, indexBufferSize);
+	commitMeshAllocation(batcher, allocation, mesh->meshBuffers, vertexBufferSize, indexBufferSize);
+	return mesh;
+}
+
+// Streaming tasks each get their own batcher, so a mesh is resident as soon as its own upload is done
+// Most meshes are much smaller than a load's staging buffer, bigger ones grow it
+constexpr static size_t gStreamingStagingSize = 4 * 1024 * 1024;
+
+static void streamMesh(SStaticMesh* inMesh, const std::filesystem::path& inPath) {
+	ZoneScopedN("Stream Mesh");
+
+	TShared<SStaticMesh> loaded = nullptr;
+	{
+		CUploadBatcher batcher(CRenderer::get(), gStreamingStagingSize);
+		loaded = loadMesh(batcher, inPath, inMesh->name);
+	}
+
+	if (!loaded) {
+		msgs("Mesh {} could not be streamed in, its bounds are drawn instead.", inMesh->name.c_str());
+		return;
+	}
+
+	// Nothing reads these until the mesh is marked resident
+	inMesh->surfaces = std::move(loaded->surfaces);
+	inMesh->lods = std::move(loaded->lods);
+	inMesh->meshlets = std::move(loaded->meshlets);
+	inMesh->meshBuffers = std::move(loaded->meshBuffers);
+	inMesh->resident.store(true, std::memory_order_release);
+}
+
+TShared<SStaticMesh> CEngineLoader::registerMesh(const std::filesystem::path& inPath, const std::string& inName) {
+	SBounds bounds;
+	if (!readMeshBounds(inPath, bounds)) {
+		msgs("Mesh file {} has no bounds!", inPath.string().c_str());
+		return nullptr;
+	}
+
+	TShared<SStaticMesh> mesh = createStaticMesh(inName, bounds, {}, {}, {});
+	mesh->resident = false;
+
+	std::error_code error;
+	const uintmax_t fileSize = std::filesystem::file_size(inPath, error);
+
+	std::lock_guard lock(get()->m_StreamingMutex);
+	get()->m_PendingMeshes.emplace(mesh.get(), SMeshDescriptor{inPath, error ? 0 : fileSize});
+	return mesh;
+}
+
+void CEngineLoader::requestMesh(SStaticMesh* inMesh) {
+	if (!inMesh || inMesh->isResident()) return;
+
+	const TShared<CEngineLoader> loader = get();
+	std::lock_guard lock(loader->m_StreamingMutex);
+
+	// Only registered meshes are pending, and each is only taken out once
+	const auto it = loader->m_PendingMeshes.find(inMesh);
+	if (it == loader->m_PendingMeshes.end()) return;
+
+	std::filesystem::path path = std::move(it->second.mPath);
+	loader->m_PendingMeshes.erase(it);
+
+	// Finished tasks are dropped here, so the list only holds what is still in flight
+	std::erase_if(loader->m_StreamingTasks, [](const CTaskHandle& inTask) { return inTask.isComplete(); });
+
+	loader->m_StreamingTasks.push_back(CThreading::runTask([inMesh, path = std::move(path)] {
+		streamMesh(inMesh, path);
+	}, {}, ETaskPriority::BACKGROUND));
+}
+
+TAssetHandle<SStaticMesh> CEngineLoader::requestMesh(const std::string& inName) {
+	const TAssetHandle<SStaticMesh> handle = getMeshes().find(inName);
+	requestMesh(getMeshes().resolve(handle));
+	return handle;
+}
+
+void CEngineLoader::waitForStreaming() {
+	std::vector<CTaskHandle> tasks;
+	{
+		std::lock_guard lock(get()->m_StreamingMutex);
+		tasks = std::move(get()->m_StreamingTasks);
+		get()->m_StreamingTasks.clear();
+	}
+
+	CThreading::whenAll(tasks).wait();
+}
+
 void CEngineLoader::save() {
 	// Only materials need to be saved (as they are the only thing created at runtime)
-	for (const auto& [name, material] : get()->mMaterials) {
-		save<TShared<CMaterial>>(name, material);
-	}
+	get()->mMaterials.forEach([](const std::string& inName, TAssetHandle<CMaterial>, const TShared<CMaterial>& inMaterial) {
+		save<TShared<CMaterial>>(inName, mMaterialChunk, 1, inMaterial);
+	});
 }
 
 void CEngineLoader::load(const TFrail<CRenderer>& renderer) {
@@ -475,70 +971,160 @@ void CEngineLoader::load(const TFrail<CRenderer>& renderer) {
 		return fileName.string();
 	};
 
+	// Every file of a type is read and decoded across the pool, only creating gpu resources is serialized (see CUploadBatcher::getResourceMutex)
+	// Results are added to the table afterward on one thread
+	auto loadAll = [&]<typename TType, typename TStorage, typename TFunc>(const std::vector<std::filesystem::path>& inPaths, TAssetTable<TType, TStorage>& outAssets, TFunc&& inLoad) {
+		// The table keeps the first asset under a name, so later files with the same name aren't loaded at all
+		// Registered meshes would otherwise leave a pending entry behind for a mesh that was never added
+		std::vector<std::filesystem::path> paths;
+		std::set<std::string> names;
+		for (const std::filesystem::path& path : inPaths) {
+			if (const std::string name = pathToName(path); outAssets.contains(name) || !names.insert(name).second) {
+				msgs("Asset {} is already loaded, skipping {}.", name, path.string());
+				continue;
+			}
+			paths.push_back(path);
+		}
+
+		// Optional since default constructing a TShared would construct the asset
+		std::vector<std::optional<TStorage>> loaded(paths.size());
+		CThreading::parallelFor(0, paths.size(), 1, [&](const size_t inIndex) {
+			loaded[inIndex].emplace(inLoad(paths[inIndex]));
+		});
+
+		for (size_t i = 0; i < paths.size(); ++i) {
+			// Assets that can fail to load come back null
+			if constexpr (std::is_constructible_v<bool, const TStorage&>) {
+				if (!*loaded[i]) continue;
+			}
+			outAssets.add(pathToName(paths[i]), std::move(*loaded[i]));
+		}
+	};
+
+	// Every upload shares one staging buffer, and is submitted in a few large batches instead of once per mesh and mip
+	CUploadBatcher batcher(renderer);
+
 	// Specific load order, since meshes reference materials, and materials reference textures
+	// Fonts don't depend on anything, so they can load alongside the rest
+	// Each asset type has its own table, so the tasks never touch the same container
 
 	// Load textures
-	for (const auto& path : textures) {
-		TShared<SVRIImage> image = loadImage(renderer, path);
-		get()->mImages.emplace(pathToName(path), image);
-	}
+	const CTaskHandle texturesLoaded = CThreading::runTask([&] {
+		loadAll(textures, get()->mImages, [&](const std::filesystem::path& path) {
+			return loadImage(batcher, path);
+		});
+	});
 
 	// Load fonts
-	for (const auto& path : fonts) {
-		SFont font = loadFont(renderer, path);
-		get()->mFonts.emplace(pathToName(path), std::move(font));
-	}
+	const CTaskHandle fontsLoaded = CThreading::runTask([&] {
+		loadAll(fonts, get()->mFonts, [&](const std::filesystem::path& path) {
+			return loadFont(batcher, path);
+		});
+	});
 
 	// Load materials
-	for (const auto& path : materials) {
-		auto material = load<TShared<CMaterial>>(path);
-		get()->mMaterials.emplace(pathToName(path), material);
-	}
+	const CTaskHandle materialsLoaded = texturesLoaded.then([&] {
+		loadAll(materials, get()->mMaterials, [&](const std::filesystem::path& path) {
+			return load<TShared<CMaterial>>(path, mMaterialChunk);
+		});
+	});
+
+	// Register meshes, only their bounds are read here and the rest streams in once something references them
+	// The renderer draws every mesh that isn't resident with the bounds meshes, so those two are loaded up front
+	const CTaskHandle meshesLoaded = materialsLoaded.then([&] {
+		loadAll(meshes, get()->mMeshes, [&](const std::filesystem::path& path) {
+			const std::string name = pathToName(path);
+			if (name == "CubeBounds" || name == "SphereBounds") {
+				return loadMesh(batcher, path, name);
+			}
+			return registerMesh(path, name);
+		});
+	});
+
+	// Everything above references local paths, so they need to finish before returning
+	CThreading::whenAll({fontsLoaded, meshesLoaded}).wait();
 
-	// Load meshes
-	for (const auto& path : meshes) {
-		auto mesh = load<SMeshData>(path);
-		get()->mMeshes.emplace(pathToName(path), toStaticMesh(renderer, mesh, pathToName(path)));
+	batcher.flush();
+
+	const CUploadBatcher::SStats stats = batcher.getStats();
+	const double megabytes = stats.mBytes / (1024.0 * 1024.0);
+	msgs("Uploaded {:.1f} MB in {} batches ({} copies), {:.1f} MB/s", megabytes, stats.mBatches, stats.mCopies, stats.mSeconds > 0.0 ? megabytes / stats.mSeconds : 0.0);
+
+	std::lock_guard lock(get()->m_StreamingMutex);
+	uintmax_t streamedSize = 0;
+	for (const auto& [mesh, descriptor] : get()->m_PendingMeshes) {
+		streamedSize += descriptor.mFileSize;
 	}
+	msgs("Registered {} meshes ({:.1f} MB) to stream on demand", get()->m_PendingMeshes.size(), streamedSize / (1024.0 * 1024.0));
 }
 
 void CEngineLoader::importTexture(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath) {
 	const std::string fileName = inPath.filename().string();
 
-	basisu::image image;
-	basisu::load_image(inPath.string().c_str(), image);
+	constexpr auto format = basist::basis_tex_format::cUASTC4x4;
+	constexpr uint32 flags = basisu::cFlagGenMipsClamp | basisu::cFlagKTX2 | basisu::cFlagSRGB | basisu::cFlagThreaded | basisu::cFlagUseOpenCL | basisu::cFlagDebug | basisu::cFlagPrintStats | basisu::cFlagPrintStatus;
+
+	SHash key;
+	{
+		CMappedArchive source(inPath.string());
+		if (!source.isOpen()) {
+			msgs("Could not read texture {}!", inPath.string());
+			return;
+		}
+
+		CHasher hasher;
+		hasher.update(source.getData());
+		hasher.update(gTextureCookVersion);
+		hasher.update(format);
+		hasher.update(flags);
+		key = hasher.finish();
+	}
+
+	// Compression with mips is by far the slowest part of an import, and the same image always compresses the same way
+	std::vector<uint8> ktx2Data;
+	if (!CDerivedDataCache::load(key, ktx2Data)) {
+		basisu::image image;
+		basisu::load_image(inPath.string().c_str(), image);
 
-	basisu::vector<basisu::image> images;
-	images.push_back(image);
+		basisu::vector<basisu::image> images;
+		images.push_back(image);
 
-	size_t file_size = 0;
-	constexpr uint32 quality = 255;
+		size_t file_size = 0;
+		constexpr uint32 quality = 255;
 
-	// TODO cETC1S is supremely smaller, but takes significantly longer to compress. cETC1S should be the main format.
-	void* pKTX2_data = basisu::basis_compress(
-		basist::basis_tex_format::cUASTC4x4,
-		images,
-		basisu::cFlagGenMipsClamp | basisu::cFlagKTX2 | basisu::cFlagSRGB | basisu::cFlagThreaded | basisu::cFlagUseOpenCL | basisu::cFlagDebug | basisu::cFlagPrintStats | basisu::cFlagPrintStatus, 0.0f,
-		&file_size,
-		nullptr);//quality |
+		// TODO cETC1S is supremely smaller, but takes significantly longer to compress. cETC1S should be the main format.
+		void* pKTX2_data = basisu::basis_compress(
+			format,
+			images,
+			flags, 0.0f,
+			&file_size,
+			nullptr);//quality |
 
-	if (!pKTX2_data) {
-		errs("Compress for file {} failed.", fileName.c_str());
+		if (!pKTX2_data) {
+			errs("Compress for file {} failed.", fileName.c_str());
+		}
+
+		ktx2Data.assign(static_cast<uint8*>(pKTX2_data), static_cast<uint8*>(pKTX2_data) + file_size);
+		basisu::basis_free_data(pKTX2_data);
+
+		CDerivedDataCache::store(key, ktx2Data);
 	}
 
 	std::filesystem::path cachedPath = SPaths::get()->mAssetPath.string() + fileName;
 	cachedPath.replace_extension(".ktx2");
 
 	// Write to ktx2 file
-	if (!basisu::write_data_to_file(cachedPath.string().c_str(), pKTX2_data, file_size)) {
+	if (!writeFileAtomic(cachedPath.string(), ktx2Data)) {
 		errs("Ktx2 file {} could not be written.", fileName.c_str());
 	}
 
-	basisu::basis_free_data(pKTX2_data);
-
-	TShared<SVRIImage> loadedImage = loadImage(renderer, cachedPath);
+	CUploadBatcher batcher(renderer);
+	TShared<SVRIImage> loadedImage = loadImage(batcher, cachedPath);
+	batcher.flush();
 
-	get()->mImages.emplace(loadedImage->mName, loadedImage);
+	if (!get()->mImages.add(loadedImage->mName, loadedImage).second) {
+		msgs("Texture {} is already loaded, the new import is used once the engine restarts.", loadedImage->mName.c_str());
+	}
 }
 
 constexpr static uint32 FONT_MAX_SIZE = 128;
@@ -572,7 +1158,7 @@ void CEngineLoader::importFont(const TFrail<CRenderer>& renderer, const std::fil
     font.mAscenderPx = face->size->metrics.ascender / 64.f;
     font.mDescenderPx = face->size->metrics.descender / 64.f;
 
-    get()->mFonts.emplace(font.mName, std::move(font));
+    get()->mFonts.add(font.mName, std::move(font));
 
 	// Do all standard ASCII characters
     for (uint8 character = 0; character < std::numeric_limits<uint8>::max(); ++character) {
@@ -617,17 +1203,16 @@ void CEngineLoader::importFont(const TFrail<CRenderer>& renderer, const std::fil
 	std::filesystem::path cachedPath = SPaths::get()->mAssetPath.string() + font.mName;
 	cachedPath.replace_extension(".fnt");
 
-	const std::string label = font.mName + " Atlas";
-	font.mAtlasImage = TUnique<SVRIImage>{label, VkExtent3D{FONT_ATLAS_SIZE, FONT_ATLAS_SIZE, 1}, VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT};
-	renderer->immediateSubmit([&](const TFrail<CVRICommands>& cmd) {
-		font.mAtlasImage->push(cmd, atlasData.data(), atlasData.size());
-	});
+	{
+		CUploadBatcher batcher(renderer);
+		uploadAtlas(batcher, font, atlasData);
+	}
 
 	// Write font and atlas data to file
-	CFileArchive file(cachedPath.string(), "wb");
-	file << font;
-	file << atlasData;
-	file.close();
+	CChunkWriter writer;
+	writer.addChunk(mFontChunk, 1, font);
+	writer.addChunkData(mFontAtlasChunk, 1, atlasData);
+	writer.writeToFile(cachedPath.string());
 
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
@@ -637,39 +1222,100 @@ void CEngineLoader::createMaterial(const std::string& inMaterialName) {
 	// Get a name that isn't taken
 	int32 materialNumber = 0;
 	std::string name;
-	bool contains = true;
-	while (contains) {
+	do {
 		name = fmts("material {}", materialNumber);
-		contains = false;
-		for (const auto& material : getMaterials()) {
-			if (material.second->mName == name) {
-				contains = true;
-				break;
-			}
-		}
 		materialNumber++;
-	}
+	} while (getMaterials().contains(name));
 
 	TShared<CMaterial> material{};
 	material->mName = name;
 
-	get()->mMaterials.emplace(name, material);
+	get()->mMaterials.add(name, material);
 }
 
-void CEngineLoader::importMesh(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath) {
+// A glTF file cooks into one .msh file per node, so the derived data is every file it produced
+struct SCookedMesh {
+	std::string mName;
+	std::vector<uint8> mFile;
+
+	friend CArchive& operator<<(CArchive& inArchive, const SCookedMesh& inMesh) {
+		inArchive << inMesh.mName;
+		inArchive << inMesh.mFile;
+		return inArchive;
+	}
+
+	friend CArchive& operator>>(CArchive& inArchive, SCookedMesh& inMesh) {
+		inArchive >> inMesh.mName;
+		inArchive >> inMesh.mFile;
+		return inArchive;
+	}
+};
+
+void CEngineLoader::importMesh(const TFrail<CRenderer>& renderer, const std::filesystem::path& inPath, const SMeshData::EVertexEncoding inEncoding, const SMeshData::SLodSettings& inLods) {
 	const std::string fileName = inPath.filename().string();
 
-	// Load the GLTF into Mesh Data
-	const auto meshData = loadGLTF_Internal(inPath);
+	CHasher hasher;
+	{
+		CMappedArchive source(inPath.string());
+		if (!source.isOpen()) {
+			msgs("Could not read mesh {}!", inPath.string());
+			return;
+		}
+		hasher.update(source.getData());
+	}
 
-	// If failed, do not write data
-	if (meshData.empty()) {
-		msgs("Mesh {} is empty!", fileName.c_str());
-		return;
+	// Text glTF files keep their buffers next to them, any of which could be one this file uses
+	if (inPath.extension() != ".glb") {
+		std::vector<std::filesystem::path> buffers;
+		for (const auto& entry : std::filesystem::directory_iterator(inPath.parent_path())) {
+			if (entry.path().extension() == ".bin") buffers.push_back(entry.path());
+		}
+		std::ranges::sort(buffers);
+
+		for (const std::filesystem::path& buffer : buffers) {
+			CMappedArchive source(buffer.string());
+			hasher.update(buffer.filename().string());
+			hasher.update(source.getData());
+		}
 	}
 
+	hasher.update(gMeshCookVersion);
+	hasher.update(SMeshData::mEncodedChunkVersion);
+	hasher.update(inEncoding);
+	hasher.update(inLods.mLodCount);
+	hasher.update(inLods.mReduction);
+	hasher.update(inLods.mMaxError);
+	const SHash key = hasher.finish();
+
+	// Parsing and optimizing is skipped entirely on a hit
+	std::vector<SCookedMesh> cookedMeshes;
+	if (!CDerivedDataCache::load(key, cookedMeshes)) {
+		// Load the GLTF into Mesh Data
+		const auto meshData = loadGLTF_Internal(inPath);
+
+		// If failed, do not write data
+		if (meshData.empty()) {
+			msgs("Mesh {} is empty!", fileName.c_str());
+			return;
+		}
+
+		for (const auto& [name, data] : meshData) {
+			data->buildLods(inLods);
+			data->buildMeshlets();
+
+			CChunkWriter writer;
+			data->saveChunks(writer, inEncoding);
+			cookedMeshes.push_back({.mName = name, .mFile = writer.finish()});
+		}
+
+		CDerivedDataCache::store(key, cookedMeshes);
+	}
+
+	CUploadBatcher batcher(renderer);
+	std::vector<std::pair<std::string, TShared<SStaticMesh>>> loadedMeshes;
+
 	// Save the mesh data
-	for (const auto& [name, data] : meshData) {
+	for (const auto& [name, file] : cookedMeshes) {
 
 		// Create an asset path with the appropriate name
 		std::filesystem::path path = SPaths::get()->mAssetPath;
@@ -678,17 +1324,22 @@ void CEngineLoader::importMesh(const TFrail<CRenderer>& renderer, const std::fil
 		// Ensure .msh doesn't already exist
 		if (std::filesystem::exists(path)) {
 			msgs("File {} already exists!", name);
-			return;
+			continue;
 		}
 
-		CFileArchive file(path.string(), "wb");
-
-		file << data;
-
-		file.close();
+		writeFileAtomic(path.string(), file);
 
-		const auto mesh = readMeshData(path);
+		// Loaded back from the file, so a quantized mesh looks the same now as it will next time
+		if (auto mesh = loadMesh(batcher, path, name)) {
+			loadedMeshes.emplace_back(name, mesh);
+		}
+	}
 
-		get()->mMeshes.emplace(name, toStaticMesh(renderer, mesh, name));
+	// Meshes are only handed to the renderer once their buffers are filled
+	batcher.flush();
+	for (auto& [name, mesh] : loadedMeshes) {
+		if (!get()->mMeshes.add(name, std::move(mesh)).second) {
+			msgs("Mesh {} is already loaded, the new import is used once the engine restarts.", name.c_str());
+		}
 	}
 }
@@ -0,0 +1,70 @@
+#include "rendercore/RenderProxy.h"
+
+SRenderSnapshot& CRenderSnapshotBuffer::beginWrite() {
+	const size_t index = m_WriteFrame % 2;
+
+	std::unique_lock lock(m_Mutex);
+	m_CV.wait(lock, [&] {
+		return m_Stop || m_States[index] == ESnapshotState::EMPTY;
+	});
+
+	// Nothing will read it, but the render thread may still be finishing the other one
+	if (m_Stop) {
+		m_Discarded.clear();
+		return m_Discarded;
+	}
+
+	m_States[index] = ESnapshotState::WRITING;
+
+	m_Snapshots[index].clear();
+	return m_Snapshots[index];
+}
+
+void CRenderSnapshotBuffer::publish() {
+	{
+		std::lock_guard lock(m_Mutex);
+		const size_t index = m_WriteFrame % 2;
+		if (m_States[index] != ESnapshotState::WRITING) return;
+		m_States[index] = ESnapshotState::READY;
+		m_WriteFrame++;
+	}
+	m_CV.notify_all();
+}
+
+const SRenderSnapshot* CRenderSnapshotBuffer::acquire(const std::chrono::milliseconds inTimeout) {
+	const size_t index = m_ReadFrame % 2;
+
+	std::unique_lock lock(m_Mutex);
+	const bool ready = m_CV.wait_for(lock, inTimeout, [&] {
+		return m_Stop || m_States[index] == ESnapshotState::READY;
+	});
+
+	if (!ready || m_Stop) return nullptr;
+
+	m_States[index] = ESnapshotState::READING;
+	return &m_Snapshots[index];
+}
+
+void CRenderSnapshotBuffer::release() {
+	{
+		std::lock_guard lock(m_Mutex);
+		const size_t index = m_ReadFrame % 2;
+		if (m_States[index] != ESnapshotState::READING) return;
+		m_States[index] = ESnapshotState::EMPTY;
+		m_ReadFrame++;
+	}
+	m_CV.notify_all();
+}
+
+void CRenderSnapshotBuffer::stop() {
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_CV.notify_all();
+}
+
+bool CRenderSnapshotBuffer::isStopped() const {
+	std::lock_guard lock(m_Mutex);
+	return m_Stop;
+}
@@ -0,0 +1,166 @@
+#include "rendercore/UploadBatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <tracy/Tracy.hpp>
+
+#include "VRI/VRICommands.h"
+
+// Covers both buffer copies and block compressed images, which need offsets that are a multiple of their block size
+constexpr static size_t gUploadAlignment = 16;
+
+static size_t alignUp(const size_t inValue) {
+	return (inValue + gUploadAlignment - 1) & ~(gUploadAlignment - 1);
+}
+
+// Batchers the current thread holds an uncommitted allocation from
+// A thread that allocates or flushes again before committing would wait on itself once the batch is full
+static thread_local std::vector<const CUploadBatcher*> gHeldAllocations;
+
+static bool isHeldByThisThread(const CUploadBatcher* inBatcher) {
+	return std::ranges::find(gHeldAllocations, inBatcher) != gHeldAllocations.end();
+}
+
+CUploadBatcher::CUploadBatcher(const TFrail<CRenderer>& inRenderer, const size_t inCapacity)
+	: m_Renderer(inRenderer),
+	m_Capacity(inCapacity) {}
+
+CUploadBatcher::~CUploadBatcher() {
+	flush();
+
+	if (m_Staging) {
+		std::lock_guard resourceLock(getResourceMutex());
+		m_Staging.destroy();
+	}
+}
+
+std::mutex& CUploadBatcher::getResourceMutex() {
+	static std::mutex resourceMutex;
+	return resourceMutex;
+}
+
+CUploadBatcher::SAllocation CUploadBatcher::allocate(const size_t inSize) {
+	// Usually a parallel for, or another task's wait, running a second load on this thread between allocate and commit
+	asts(!isHeldByThisThread(this), "Upload batcher allocation of {} bytes made before this thread committed its last one.", inSize);
+
+	std::unique_lock lock(m_Mutex);
+
+	// Don't start anything new while a full batch waits on the allocations it already has
+	m_Committed.wait(lock, [this] { return !m_Flushing; });
+
+	const size_t offset = alignUp(m_Used);
+	if (offset + inSize > m_Capacity) {
+		flush(lock);
+
+		// Only an upload bigger than the whole buffer grows it, everything else fits after a flush
+		if (inSize > m_Capacity) {
+			m_Capacity = alignUp(inSize);
+			if (m_Staging) {
+				std::lock_guard resourceLock(getResourceMutex());
+				m_Staging.destroy();
+				m_Staging = nullptr;
+			}
+		}
+	}
+
+	if (!m_Staging) {
+		std::lock_guard resourceLock(getResourceMutex());
+		m_Staging = TUnique<SVRIBuffer>{m_Capacity, VMA_MEMORY_USAGE_CPU_ONLY, VK_BUFFER_USAGE_TRANSFER_SRC_BIT};
+	}
+
+	const size_t start = alignUp(m_Used);
+	m_Used = start + inSize;
+	m_Outstanding++;
+	gHeldAllocations.push_back(this);
+
+	uint8* data = static_cast<uint8*>(m_Staging->getMappedData()) + start;
+	return {std::span{data, inSize}, start};
+}
+
+void CUploadBatcher::commit(const SAllocation& inAllocation, FRecordCopy inRecord) {
+	std::lock_guard lock(m_Mutex);
+
+	if (inRecord) {
+		m_Commands.emplace_back([this, offset = inAllocation.mOffset, record = std::move(inRecord)](const TFrail<CVRICommands>& cmd) {
+			record(cmd, m_Staging, offset);
+		});
+
+		m_Stats.mBytes += inAllocation.mData.size();
+		m_Stats.mCopies++;
+	}
+
+	m_Outstanding--;
+	m_Committed.notify_all();
+
+	if (const auto itr = std::ranges::find(gHeldAllocations, this); itr != gHeldAllocations.end()) {
+		gHeldAllocations.erase(itr);
+	}
+}
+
+void CUploadBatcher::record(FRecord inRecord) {
+	std::lock_guard lock(m_Mutex);
+	m_Commands.push_back(std::move(inRecord));
+}
+
+void CUploadBatcher::uploadToImage(const TFrail<SVRIImage>& inImage, const void* inData, const size_t inSize, const uint32 inMipLevel, const VkExtent3D inExtent) {
+	const SAllocation allocation = allocate(inSize);
+	memcpy(allocation.mData.data(), inData, inSize);
+
+	commit(allocation, [inImage, inMipLevel, inExtent](const TFrail<CVRICommands>& cmd, const TFrail<SVRIBuffer>& staging, const size_t offset) {
+		const VkBufferImageCopy copyRegion = {
+			.bufferOffset = offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = inMipLevel,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = {},
+			.imageExtent = inExtent
+		};
+		cmd->copyBufferToImage(staging, inImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, copyRegion);
+	});
+}
+
+void CUploadBatcher::flush() {
+	asts(!isHeldByThisThread(this), "Upload batcher flushed before this thread committed its allocation.");
+
+	std::unique_lock lock(m_Mutex);
+	m_Committed.wait(lock, [this] { return !m_Flushing; });
+	flush(lock);
+}
+
+void CUploadBatcher::flush(std::unique_lock<std::mutex>& inLock) {
+	m_Flushing = true;
+	m_Committed.wait(inLock, [this] { return m_Outstanding == 0; });
+
+	if (!m_Commands.empty()) {
+		ZoneScopedN("Upload Batch");
+
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		// The lock stays held, so nothing writes into the staging buffer until the gpu is done reading it
+		m_Renderer->immediateSubmit([this](const TFrail<CVRICommands>& cmd) {
+			for (const FRecord& command : m_Commands) {
+				command(cmd);
+			}
+		});
+
+		m_Stats.mSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		m_Stats.mBatches++;
+		m_Commands.clear();
+	}
+
+	m_Used = 0;
+	m_Flushing = false;
+	m_Committed.notify_all();
+}
+
+CUploadBatcher::SStats CUploadBatcher::getStats() const {
+	std::lock_guard lock(m_Mutex);
+	return m_Stats;
+}
@@ -18,8 +18,9 @@ public:
 	CEngineTextures() = default;
 	EXPORT CEngineTextures(const TFrail<CRenderer>& renderer);
 
-	EXPORT void initializeTextures();
+	EXPORT void initializeTextures(Extent32u inExtent);
 
+	// Resizes to the extent in the frame's snapshot
 	EXPORT void reallocate(const SRendererInfo& info, bool inUseVSync = true);
 
 	EXPORT virtual void destroy() override;
@@ -3,6 +3,7 @@
 #include "renderer/object/ObjectRenderer.h"
 #include "scene/world/StaticMeshObject.h"
 #include "renderer/passes/MeshPass.h"
+#include "rendercore/RenderProxy.h"
 
 class CStaticMeshObjectRenderer : public CWorldObjectRenderer<CStaticMeshObject, CMeshPass> {
 
@@ -10,18 +11,33 @@ class CStaticMeshObjectRenderer : public CWorldObjectRenderer<CStaticMeshObject,
 
 public:
 
-	typedef class {
+	typedef SStaticMeshProxy Proxy;
 
-	} Proxy;
-
-	virtual void begin() override {
-		m_LastIndexBuffer = VK_NULL_HANDLE;
-	}
+	EXPORT virtual void begin() override;
 
 	EXPORT virtual void render(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, SRenderStack3f& stack, CStaticMeshObject* inObject, size_t& outDrawCalls, size_t& outVertices) override;
 
+	// Draws a proxy from the frame's snapshot, its instances are read from inInstanceBuffer at the proxy's instance range
+	// The instances are grouped by lod, inLodCounts says how many are in each group
+	EXPORT void render(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMeshProxies& inProxies, size_t inIndex, VkBuffer inInstanceBuffer, const CMeshPass::LodCounts& inLodCounts, size_t& outDrawCalls, size_t& outVertices);
+
 private:
 
+	void draw(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, const CMaterial* inMaterial, uint32 inLod, VkBuffer inInstanceBuffer, uint32 inFirstInstance, uint32 inNumInstances, size_t& outDrawCalls, size_t& outVertices);
+
+	// Full detail surfaces, without the meshlets that are out of view or facing away
+	void drawClusters(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, const CMaterial* inMaterial, const Matrix4f& inTransform, VkBuffer inInstanceBuffer, uint32 inInstance, size_t& outDrawCalls, size_t& outVertices);
+
+	// Wireframe box and sphere around the mesh, also what stands in for a mesh that is still streaming
+	void drawBounds(CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, VkBuffer inInstanceBuffer, uint32 inFirstInstance, uint32 inNumInstances);
+
+	void bindBuffers(const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, VkBuffer inInstanceBuffer);
+
 	VkBuffer m_LastIndexBuffer = VK_NULL_HANDLE;
+	VkBuffer m_LastInstanceBuffer = VK_NULL_HANDLE;
+
+	// Found by name once, and again only if they are removed
+	TAssetHandle<SStaticMesh> m_CubeBoundsMesh{};
+	TAssetHandle<SStaticMesh> m_SphereBoundsMesh{};
 
 };
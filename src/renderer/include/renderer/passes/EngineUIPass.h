@@ -10,8 +10,6 @@ public:
 
 	EXPORT virtual void init(TFrail<CRenderer> inRenderer) override;
 
-	EXPORT virtual void begin() override;
-
 	EXPORT virtual void render(const SRendererInfo& info, const TFrail<CVRICommands>& cmd) override;
 
 	EXPORT virtual void destroy() override;
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "rendercore/Pass.h"
+#include "rendercore/Instancer.h"
+#include "rendercore/StaticMesh.h"
 
 class CVulkanRenderer;
 
@@ -10,6 +12,9 @@ class CMeshPass : public CPass {
 
 public:
 
+	// How many of a proxy's instances are drawn at each lod
+	using LodCounts = std::array<uint32, SStaticMesh::mMaxLods>;
+
 	EXPORT virtual void init(TFrail<CRenderer> inRenderer) override;
 
 	EXPORT void destroy() override;
@@ -24,4 +29,23 @@ public:
 	TUnique<SPipeline> errorPipeline = nullptr;
 	TUnique<SPipeline> wireframePipeline = nullptr;
 	TUnique<SPipeline> transparentPipeline = nullptr;
+
+private:
+
+	// World space transforms for every instance in the snapshot, uploaded once per frame
+	std::vector<SInstance> m_WorldInstances;
+
+	// The same transforms in snapshot order, before they are grouped by lod
+	std::vector<SInstance> m_UngroupedInstances;
+
+	std::vector<uint8> m_InstanceLods;
+
+	std::vector<LodCounts> m_LodCounts;
+
+	using InstanceBuffer = SDynamicBuffer<VMA_MEMORY_USAGE_GPU_ONLY, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT>;
+
+	std::array<InstanceBuffer, 2> m_InstanceBuffers {
+		InstanceBuffer{"Mesh Pass Instance Buffer 0"},
+		InstanceBuffer{"Mesh Pass Instance Buffer 1"}
+	};
 };
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "rendercore/Material.h"
 #include "renderer/VulkanRenderer.h"
 #include "engine/Viewport.h"
+#include "rendercore/RenderProxy.h"
 
 #include "VRI/VRICommands.h"
 #include "VRI/VRISwapchain.h"
@@ -64,6 +65,7 @@ CEngineTextures::CEngineTextures(const TFrail<CRenderer>& renderer) {
 
 		const auto sets = {writeSet, writeSet2};
 
+		std::lock_guard lock(CBindlessResources::getMutex());
 		vkUpdateDescriptorSets(CVRI::get()->getDevice()->device, (uint32)sets.size(), sets.begin(), 0, nullptr);
 	}
 
@@ -92,10 +94,11 @@ CEngineTextures::CEngineTextures(const TFrail<CRenderer>& renderer) {
 		mErrorMaterial->mPassType = EMaterialPass::ERROR;
 	}
 
-	initializeTextures();
+	// Created before the render thread starts, so the viewport can still be read directly
+	initializeTextures(CEngine::get()->getViewport()->mExtent);
 }
 
-void CEngineTextures::initializeTextures() {
+void CEngineTextures::initializeTextures(const Extent32u inExtent) {
 
 	// Ensure previous textures have been destroyed
 	// This is in the case of screen resizing
@@ -106,21 +109,19 @@ void CEngineTextures::initializeTextures() {
 
 	constexpr VkImageUsageFlags drawImageUsages = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-	const auto extent = CEngine::get()->getViewport()->mExtent;
+	mDrawImage = TUnique<SVRIImage>{"Draw Image", VkExtent3D{inExtent.x, inExtent.y, 1}, VK_FORMAT_R16G16B16A16_SFLOAT, drawImageUsages, VK_IMAGE_ASPECT_COLOR_BIT};
 
-	mDrawImage = TUnique<SVRIImage>{"Draw Image", VkExtent3D{extent.x, extent.y, 1}, VK_FORMAT_R16G16B16A16_SFLOAT, drawImageUsages, VK_IMAGE_ASPECT_COLOR_BIT};
-
-	mDepthImage = TUnique<SVRIImage>{"Depth Image", VkExtent3D{extent.x, extent.y, 1}, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT};
+	mDepthImage = TUnique<SVRIImage>{"Depth Image", VkExtent3D{inExtent.x, inExtent.y, 1}, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT};
 }
 
 void CEngineTextures::reallocate(const SRendererInfo& info, const bool inUseVSync) {
 
-	auto extent = CEngine::get()->getViewport()->mExtent;
+	const Extent32u extent = info.snapshot->mViewportExtent;
 	msgs("Reallocating Engine Textures to ({}, {})", extent.x, extent.y);
 
-	CVRI::get()->getSwapchain()->recreate(inUseVSync);
+	CVRI::get()->getSwapchain()->recreate(extent, inUseVSync);
 
-	initializeTextures();
+	initializeTextures(extent);
 }
 
 void CEngineTextures::destroy() {
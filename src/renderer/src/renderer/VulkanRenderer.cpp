@@ -18,6 +18,7 @@
 #include "renderer/passes/SpritePass.h"
 #include "engine/Viewport.h"
 #include "VRI/BindlessResources.h"
+#include "rendercore/RenderProxy.h"
 #include "rendercore/RenderThread.h"
 #include "renderer/object/ObjectRenderer.h"
 #include "renderer/object/StaticMeshObjectRenderer.h"
@@ -114,6 +115,8 @@ void CVulkanRenderer::init() {
 
 //TODO: members are destroyed in reverse order, so that can be used instead.
 void CVulkanRenderer::destroy() {
+	CEngineLoader::waitForStreaming();
+
 	CRenderer::destroy();
 
 	//TODO: CEngineLoader self destroy
@@ -143,15 +146,17 @@ void CVulkanRenderer::destroy() {
 }
 
 void CVulkanRenderer::render(SRendererInfo& info) {
-	if (mVSync != UseVsync.get()) {
-		mVSync = UseVsync.get();
-		msgs("Reallocating Swapchain to {}", UseVsync.get() ? "enable VSync." : "disable VSync.");
+	// Settings and the viewport are read from the snapshot, the game thread owns the real ones
+	const SRenderSnapshot& snapshot = *info.snapshot;
+
+	if (mVSync != UseVsync.get(snapshot.mSettings)) {
+		mVSync = UseVsync.get(snapshot.mSettings);
+		msgs("Reallocating Swapchain to {}", mVSync ? "enable VSync." : "disable VSync.");
 		CVRI::get()->getSwapchain()->setDirty();
 	}
 
-	if (info.viewport->isDirty()) {
+	if (snapshot.mViewportResized) {
 		CVRI::get()->getSwapchain()->setDirty();
-		info.viewport->clean();
 	}
 
 	auto swapchainDirtyCheck = [&] {
@@ -160,7 +165,7 @@ void CVulkanRenderer::render(SRendererInfo& info) {
 			// Wait for gpu before recreating swapchain
 			if (!wait()) continue;
 
-			mEngineTextures->reallocate(info, UseVsync.get());
+			mEngineTextures->reallocate(info, mVSync);
 
 			for (const auto& pass : getPasses()) {
 				pass->update();
@@ -212,12 +217,10 @@ void CVulkanRenderer::render(SRendererInfo& info) {
 		cmd->transitionImage(mEngineTextures->mDepthImage, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
 
 		VkExtent2D extent {
-			CEngine::get()->getViewport()->mExtent.x,
-			CEngine::get()->getViewport()->mExtent.y
+			snapshot.mViewportExtent.x,
+			snapshot.mViewportExtent.y
 		};
 
-		info.scene->update();
-
 		{
 			ZoneScopedN("Update Scene Data");
 
@@ -227,7 +230,7 @@ void CVulkanRenderer::render(SRendererInfo& info) {
 				mSceneData.mScreenSize = Vector2f((float)extent.width, (float)extent.height);
 				mSceneData.mInvScreenSize = Vector2f(1.f / (float)extent.width, 1.f / (float)extent.height);
 
-				mSceneData.mViewProj = info.scene->mMainCamera->getViewProjectionMatrix();
+				mSceneData.mViewProj = snapshot.mViewProjection;
 
 				//some default lighting parameters
 				mSceneData.mAmbientColor = glm::vec4(.1f);
@@ -257,7 +260,7 @@ void CVulkanRenderer::render(SRendererInfo& info) {
 				pair.obj()->begin();
 			});
 
-			cmd->setViewportScissor(info.viewport->mExtent);
+			cmd->setViewportScissor(snapshot.mViewportExtent);
 
 			CPass* previousPass = nullptr;
 			for (const auto& pass : getPasses()) {
@@ -269,10 +272,10 @@ void CVulkanRenderer::render(SRendererInfo& info) {
 				if (previousPass) {
 					if (!pass->hasSameRenderingInfo(previousPass)) {
 						cmd->endRendering();
-						pass->beginRendering(cmd, info.viewport->mExtent, mEngineTextures->mDrawImage, mEngineTextures->mDepthImage);
+						pass->beginRendering(cmd, snapshot.mViewportExtent, mEngineTextures->mDrawImage, mEngineTextures->mDepthImage);
 					}
 				} else {
-					pass->beginRendering(cmd, info.viewport->mExtent, mEngineTextures->mDrawImage, mEngineTextures->mDepthImage);
+					pass->beginRendering(cmd, snapshot.mViewportExtent, mEngineTextures->mDrawImage, mEngineTextures->mDepthImage);
 				}
 
 				pass->render(info, cmd);
@@ -3,11 +3,79 @@
 #include "rendercore/Pass.h"
 #include "renderer/passes/MeshPass.h"
 #include "rendercore/EngineLoader.h"
+#include "engine/EngineSettings.h"
 #include "renderer/EngineTextures.h"
 #include "renderer/VulkanRenderer.h"
 #include "tracy/Tracy.hpp"
 #include "VRI/VRICommands.h"
 
+#define SETTINGS_CATEGORY "Rendering"
+ADD_COMMAND(bool, ClusterCulling, true);
+#undef SETTINGS_CATEGORY
+
+// Tests meshlets in the mesh's own space, so none of them have to be transformed
+struct SClusterCuller {
+
+	SClusterCuller(const Matrix4f& inViewProj, const Vector3f& inCameraPosition, const Matrix4f& inTransform) {
+		// The planes of an object to clip matrix are the frustum's planes in object space
+		// Depth is reversed and infinite, so there is no far plane, and the near plane is where z reaches w
+		const Matrix4f rows = glm::transpose(inViewProj * inTransform);
+		m_Planes = {
+			rows[3] + rows[0],
+			rows[3] - rows[0],
+			rows[3] + rows[1],
+			rows[3] - rows[1],
+			rows[3] - rows[2]
+		};
+		for (Vector4f& plane : m_Planes) {
+			plane /= glm::length(Vector3f(plane));
+		}
+
+		m_CameraPosition = Vector3f(glm::inverse(inTransform) * Vector4f(inCameraPosition, 1.f));
+
+		// Cones only hold up under uniform scale without mirroring, otherwise only the spheres are tested
+		const Vector3f x{inTransform[0]}, y{inTransform[1]}, z{inTransform[2]};
+		const Vector3f scale{glm::length(x), glm::length(y), glm::length(z)};
+		const float maxScale = std::max({scale.x, scale.y, scale.z});
+		const float minScale = std::min({scale.x, scale.y, scale.z});
+		m_TestCones = maxScale - minScale <= maxScale * 0.01f && glm::dot(glm::cross(x, y), z) > 0.f;
+	}
+
+	no_discard bool isVisible(const SMeshlet& inMeshlet) const {
+		for (const Vector4f& plane : m_Planes) {
+			if (glm::dot(Vector3f(plane), inMeshlet.mCenter) + plane.w < -inMeshlet.mRadius) return false;
+		}
+
+		return !m_TestCones || glm::dot(glm::normalize(inMeshlet.mConeApex - m_CameraPosition), inMeshlet.mConeAxis) < inMeshlet.mConeCutoff;
+	}
+
+private:
+
+	std::array<Vector4f, 5> m_Planes;
+
+	Vector3f m_CameraPosition;
+
+	bool m_TestCones;
+};
+
+static const CMaterial* getSurfaceMaterial(const SRendererInfo& info, const CMaterial* inMaterial, const SStaticMesh::Surface& inSurface) {
+	if (inMaterial) return inMaterial;
+	if (inSurface.material) return inSurface.material;
+	return info.renderer.staticCast<CVulkanRenderer>()->mEngineTextures->mErrorMaterial.get();
+}
+
+void CStaticMeshObjectRenderer::begin() {
+	m_LastIndexBuffer = VK_NULL_HANDLE;
+	m_LastInstanceBuffer = VK_NULL_HANDLE;
+
+	if (!CEngineLoader::getMeshes().resolve(m_CubeBoundsMesh)) {
+		m_CubeBoundsMesh = CEngineLoader::getMeshes().find("CubeBounds");
+	}
+	if (!CEngineLoader::getMeshes().resolve(m_SphereBoundsMesh)) {
+		m_SphereBoundsMesh = CEngineLoader::getMeshes().find("SphereBounds");
+	}
+}
+
 void CStaticMeshObjectRenderer::render(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, SRenderStack3f& stack, CStaticMeshObject* inObject, size_t& outDrawCalls, size_t& outVertices) {
 	IInstancer& instancer = inObject->getInstancer();
 	SStaticMesh* mesh = inObject->getMesh();
@@ -17,55 +85,142 @@ void CStaticMeshObjectRenderer::render(const SRendererInfo& info, CMeshPass* inP
 	ZoneScoped;
 	ZoneName(inObject->mName.c_str(), inObject->mName.size());
 
-	// Rebind index buffer if starting a new mesh
-	if (m_LastIndexBuffer != mesh->meshBuffers->indexBuffer->buffer) {
-		ZoneScopedN("Bind Buffers");
+	draw(info, inPass, cmd, mesh, nullptr, 0, instancer.get(stack)->buffer, 0, (uint32)NumInstances, outDrawCalls, outVertices);
+}
 
-		m_LastIndexBuffer = mesh->meshBuffers->indexBuffer->buffer;
-		cmd->bindIndexBuffers(mesh->meshBuffers->indexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
-		const auto offset = {
-			VkDeviceSize { 0 },
-			VkDeviceSize { 0 }
-		};
+void CStaticMeshObjectRenderer::render(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMeshProxies& inProxies, const size_t inIndex, VkBuffer inInstanceBuffer, const CMeshPass::LodCounts& inLodCounts, size_t& outDrawCalls, size_t& outVertices) {
+	const SStaticMesh* mesh = inProxies.mMeshes[inIndex];
+	if (!mesh) return;
+	const SInstanceRange& instances = inProxies.mInstanceRanges[inIndex];
 
-		const auto buffers = {
-			mesh->meshBuffers->vertexBuffer->buffer,
-			instancer.get(stack)->buffer
-		};
-		cmd->bindVertexBuffers(0, static_cast<uint32>(buffers.size()), buffers.begin(), offset.begin());
+	ZoneScoped;
+	ZoneName(mesh->name.c_str(), mesh->name.size());
+
+	// Meshlets are culled for a single transform, so only proxies with one instance can use them
+	if (info.snapshot && ClusterCulling.get(info.snapshot->mSettings) && instances.mCount == 1 && inLodCounts[0] == 1 && mesh->isResident() && !mesh->meshlets.empty()) {
+		const Matrix4f transform = inProxies.mTransforms[inIndex] * info.snapshot->mInstances[instances.mFirst].Transform;
+		drawClusters(info, inPass, cmd, mesh, inProxies.mMaterials[inIndex], transform, inInstanceBuffer, instances.mFirst, outDrawCalls, outVertices);
+		return;
 	}
 
-	// Loop through surfaces and render
-	for (const auto& surface : mesh->surfaces) {
+	uint32 firstInstance = instances.mFirst;
+	for (uint32 lod = 0; lod < SStaticMesh::mMaxLods; ++lod) {
+		if (inLodCounts[lod] == 0) continue;
+		draw(info, inPass, cmd, mesh, inProxies.mMaterials[inIndex], lod, inInstanceBuffer, firstInstance, inLodCounts[lod], outDrawCalls, outVertices);
+		firstInstance += inLodCounts[lod];
+	}
+}
+
+void CStaticMeshObjectRenderer::bindBuffers(const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, VkBuffer inInstanceBuffer) {
+	// Only rebind if starting a new mesh or instance buffer
+	if (m_LastIndexBuffer == inMesh->meshBuffers->indexBuffer->buffer && m_LastInstanceBuffer == inInstanceBuffer) {
+		return;
+	}
 
+	ZoneScopedN("Bind Buffers");
 
-		const CMaterial* material = info.renderer.staticCast<CVulkanRenderer>()->mEngineTextures->mErrorMaterial.get();
-		if (surface.material) {
-			material = surface.material;
-		}
+	m_LastIndexBuffer = inMesh->meshBuffers->indexBuffer->buffer;
+	m_LastInstanceBuffer = inInstanceBuffer;
+	cmd->bindIndexBuffers(inMesh->meshBuffers->indexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
+	const auto offset = {
+		VkDeviceSize { 0 },
+		VkDeviceSize { 0 }
+	};
+
+	const auto buffers = {
+		inMesh->meshBuffers->vertexBuffer->buffer,
+		inInstanceBuffer
+	};
+	cmd->bindVertexBuffers(0, static_cast<uint32>(buffers.size()), buffers.begin(), offset.begin());
+}
+
+void CStaticMeshObjectRenderer::draw(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, const CMaterial* inMaterial, const uint32 inLod, VkBuffer inInstanceBuffer, const uint32 inFirstInstance, const uint32 inNumInstances, size_t& outDrawCalls, size_t& outVertices) {
+	// Streamed meshes have no buffers until they are resident, so only their bounds are drawn in the meantime
+	if (!inMesh->isResident()) {
+		drawBounds(inPass, cmd, inMesh, inInstanceBuffer, inFirstInstance, inNumInstances);
+		return;
+	}
+
+	bindBuffers(cmd, inMesh, inInstanceBuffer);
+
+	// Level 0 is the surfaces themselves
+	const SMeshLod* lod = inLod > 0 && inLod <= inMesh->lods.size() ? &inMesh->lods[inLod - 1] : nullptr;
+
+	// Loop through surfaces and render
+	for (size_t surfaceIndex = 0; surfaceIndex < inMesh->surfaces.size(); ++surfaceIndex) {
+		const SStaticMesh::Surface& surface = inMesh->surfaces[surfaceIndex];
+		const SIndexRange range = lod ? lod->mSurfaces[surfaceIndex] : SIndexRange{surface.startIndex, surface.count};
+		if (range.mCount == 0) continue;
+
+		const CMaterial* material = getSurfaceMaterial(info, inMaterial, surface);
 
 		//TODO: auto pipeline rebind (or something)
 		// If the materials arent the same, rebind material data
 		inPass->bindPipeline(cmd, inPass->opaquePipeline.get(), material->mConstants);
 		//surface.material->getPipeline(renderer) TODO: pipelines
-		cmd->drawIndexed(surface.count, (uint32)NumInstances, surface.startIndex, 0, 0);
+		cmd->drawIndexed(range.mCount, inNumInstances, range.mStartIndex, 0, inFirstInstance);
+
+		outDrawCalls++;
+		outVertices += range.mCount * inNumInstances;
+	}
+
+	//TODO: If Render Bounds
+	drawBounds(inPass, cmd, inMesh, inInstanceBuffer, inFirstInstance, inNumInstances);
+}
 
+void CStaticMeshObjectRenderer::drawClusters(const SRendererInfo& info, CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, const CMaterial* inMaterial, const Matrix4f& inTransform, VkBuffer inInstanceBuffer, const uint32 inInstance, size_t& outDrawCalls, size_t& outVertices) {
+	ZoneScopedN("Draw Clusters");
+
+	bindBuffers(cmd, inMesh, inInstanceBuffer);
+
+	const SClusterCuller culler(info.snapshot->mViewProjection, info.snapshot->mCameraPosition, inTransform);
+
+	// Visible meshlets next to each other in the index buffer are drawn together
+	SIndexRange run{};
+	auto drawRun = [&] {
+		if (run.mCount == 0) return;
+		cmd->drawIndexed(run.mCount, 1, run.mStartIndex, 0, inInstance);
 		outDrawCalls++;
-		outVertices += surface.count * NumInstances;
+		outVertices += run.mCount;
+		run = {};
+	};
+
+	uint32 boundSurface = std::numeric_limits<uint32>::max();
+	for (const SMeshlet& meshlet : inMesh->meshlets) {
+		if (!culler.isVisible(meshlet)) continue;
+
+		// Meshlets are in surface order, so each surface's pipeline is only bound once
+		if (meshlet.mSurface != boundSurface) {
+			drawRun();
+			boundSurface = meshlet.mSurface;
+			inPass->bindPipeline(cmd, inPass->opaquePipeline.get(), getSurfaceMaterial(info, inMaterial, inMesh->surfaces[meshlet.mSurface])->mConstants);
+		}
+
+		if (run.mCount > 0 && run.mStartIndex + run.mCount == meshlet.mStartIndex) {
+			run.mCount += meshlet.mCount;
+		} else {
+			drawRun();
+			run = {meshlet.mStartIndex, meshlet.mCount};
+		}
 	}
+	drawRun();
 
 	//TODO: If Render Bounds
+	drawBounds(inPass, cmd, inMesh, inInstanceBuffer, inInstance, 1);
+}
 
-	if (CEngineLoader::getMeshes().contains("CubeBounds") && CEngineLoader::getMeshes().contains("SphereBounds")) {
-		const SStaticMesh* cubeBoundsMesh = CEngineLoader::getMeshes()["CubeBounds"].get();
-		const SStaticMesh* sphereBoundsMesh = CEngineLoader::getMeshes()["SphereBounds"].get();
+void CStaticMeshObjectRenderer::drawBounds(CMeshPass* inPass, const TFrail<CVRICommands>& cmd, const SStaticMesh* inMesh, VkBuffer inInstanceBuffer, const uint32 inFirstInstance, const uint32 inNumInstances) {
+	const SStaticMesh* cubeBoundsMesh = CEngineLoader::getMeshes().resolve(m_CubeBoundsMesh);
+	const SStaticMesh* sphereBoundsMesh = CEngineLoader::getMeshes().resolve(m_SphereBoundsMesh);
+	if (cubeBoundsMesh && sphereBoundsMesh) {
+		if (!cubeBoundsMesh->isResident() || !sphereBoundsMesh->isResident()) return;
 
 		// Fill with matrix transform for bounds
 		SPushConstants boxPcs;
 
 		Transform3f transform;
-		transform.setPosition(mesh->bounds.origin);
-		transform.setScale(mesh->bounds.extents);
+		transform.setPosition(inMesh->bounds.origin);
+		transform.setScale(inMesh->bounds.extents);
 		Matrix4f mat = transform.toMatrix();
 
 		boxPcs[0] = mat[0];
@@ -76,7 +231,7 @@ void CStaticMeshObjectRenderer::render(const SRendererInfo& info, CMeshPass* inP
 
 		SPushConstants spherePcs;
 
-		transform.setScale(Vector3f(mesh->bounds.sphereRadius));
+		transform.setScale(Vector3f(inMesh->bounds.sphereRadius));
 		mat = transform.toMatrix();
 
 		spherePcs[0] = mat[0];
@@ -88,52 +243,26 @@ void CStaticMeshObjectRenderer::render(const SRendererInfo& info, CMeshPass* inP
 		// Render Bounds cube
 		{
 			// Bind Wireframe mesh data
-			if (m_LastIndexBuffer != cubeBoundsMesh->meshBuffers->indexBuffer->buffer) {
-				m_LastIndexBuffer = cubeBoundsMesh->meshBuffers->indexBuffer->buffer;
-				cmd->bindIndexBuffers(cubeBoundsMesh->meshBuffers->indexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
-				const auto offset = {
-					VkDeviceSize { 0 },
-					VkDeviceSize { 0 }
-				};
-
-				const auto buffers = {
-					cubeBoundsMesh->meshBuffers->vertexBuffer->buffer,
-					instancer.get(stack)->buffer
-				};
-				cmd->bindVertexBuffers(0, static_cast<uint32>(buffers.size()), buffers.begin(), offset.begin());
-			}
+			bindBuffers(cmd, cubeBoundsMesh, inInstanceBuffer);
 
 			for (const auto& surface : cubeBoundsMesh->surfaces) {
 
 				inPass->bindPipeline(cmd, inPass->wireframePipeline.get(), boxPcs);
 
-				cmd->drawIndexed(surface.count, (uint32)NumInstances, surface.startIndex, 0, 0);
+				cmd->drawIndexed(surface.count, inNumInstances, surface.startIndex, 0, inFirstInstance);
 			}
 		}
 
 		// Render Bounds sphere
 		{
 			// Bind Wireframe mesh data
-			if (m_LastIndexBuffer != sphereBoundsMesh->meshBuffers->indexBuffer->buffer) {
-				m_LastIndexBuffer = sphereBoundsMesh->meshBuffers->indexBuffer->buffer;
-				cmd->bindIndexBuffers(sphereBoundsMesh->meshBuffers->indexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
-				const auto offset = {
-					VkDeviceSize { 0 },
-					VkDeviceSize { 0 }
-				};
-
-				const auto buffers = {
-					sphereBoundsMesh->meshBuffers->vertexBuffer->buffer,
-					instancer.get(stack)->buffer
-				};
-				cmd->bindVertexBuffers(0, static_cast<uint32>(buffers.size()), buffers.begin(), offset.begin());
-			}
+			bindBuffers(cmd, sphereBoundsMesh, inInstanceBuffer);
 
 			for (const auto& surface : sphereBoundsMesh->surfaces) {
 
 				inPass->bindPipeline(cmd, inPass->wireframePipeline.get(), spherePcs);
 
-				cmd->drawIndexed(surface.count, (uint32)NumInstances, surface.startIndex, 0, 0);
+				cmd->drawIndexed(surface.count, inNumInstances, surface.startIndex, 0, inFirstInstance);
 			}
 		}
 	}
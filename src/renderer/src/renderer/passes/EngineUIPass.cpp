@@ -21,6 +21,7 @@
 #include "renderer/EngineTextures.h"
 #include "scene/viewport/generic/Text.h"
 #include "VRI/VRICommands.h"
+#include "rendercore/RenderProxy.h"
 
 void renderSceneUI(const SRendererInfo& info) {
 	if (ImGui::Begin("Scene")) {
@@ -54,20 +55,20 @@ void renderSceneUI(const SRendererInfo& info) {
 					if (auto sobject = dynamic_cast<CStaticMeshObject*>(object.get())) {
 						const char* combo_preview_value = sobject->getMesh() ? sobject->getMesh()->name.c_str() : "None";
 						if (ImGui::BeginCombo("Meshes", combo_preview_value, ImGuiComboFlags_HeightRegular)) {
-							for (auto& mesh : CEngineLoader::getMeshes()) {
-								if (mesh.second->name.empty()) continue;
+							CEngineLoader::getMeshes().forEach([&](const std::string&, const TAssetHandle<SStaticMesh> handle, const TShared<SStaticMesh>& mesh) {
+								if (mesh->name.empty()) return;
 
-								const bool is_selected = ((sobject->getMesh() ? sobject->getMesh()->name : "None") == mesh.second->name);
-								if (ImGui::Selectable(CEngineLoader::getMeshes()[mesh.first]->name.c_str(), is_selected)) {
-									sobject->mesh = mesh.second.get();
-									msgs("attempted to set {} to {}", sobject->mesh ? sobject->mesh->name.c_str() : "None", mesh.second->name.c_str());
+								const bool is_selected = sobject->mesh == handle;
+								if (ImGui::Selectable(mesh->name.c_str(), is_selected)) {
+									msgs("attempted to set {} to {}", sobject->getMesh() ? sobject->getMesh()->name.c_str() : "None", mesh->name.c_str());
+									sobject->mesh = handle;
 								}
 
 
 								// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
 								if (is_selected)
 									ImGui::SetItemDefaultFocus();
-							}
+							});
 							ImGui::EndCombo();
 						}
 					}
@@ -104,12 +105,12 @@ void renderFontUI(const SRendererInfo& info) {
 			});
 		}
 
-		for (auto& font : CEngineLoader::getFonts()) {
-			if (ImGui::BeginCombo("Font", font.first.c_str(), ImGuiComboFlags_HeightRegular)) {
+		for (const auto& [name, handle] : CEngineLoader::getFonts().getNames()) {
+			if (ImGui::BeginCombo("Font", name.c_str(), ImGuiComboFlags_HeightRegular)) {
 				static uint32 selected = 0;
 				for (int32 i = 0; i < CEngineLoader::getFonts().size(); ++i) {
 					const bool isSelected = selected == i;
-					if (ImGui::Selectable(font.first.c_str(), isSelected))
+					if (ImGui::Selectable(name.c_str(), isSelected))
 						selected = i;
 
 					// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
@@ -139,9 +140,10 @@ void renderTextureUI(const SRendererInfo& info) {
 			//TODO: file query shouldnt be in viewport
 			CEngineViewport::queryForFile(filters, [&](std::vector<std::string> inFiles) {
 				for (const auto& file : inFiles) {
+					// Compression can take a long time, so keep it off of the threads frames use
 					CThreading::runOnBackgroundThread([info, file] {
 						CEngineLoader::importTexture(info.renderer, file);
-					});
+					}, ETaskPriority::BACKGROUND);
 				}
 			});
 		}
@@ -150,7 +152,7 @@ void renderTextureUI(const SRendererInfo& info) {
 }
 
 void renderMaterialUI(const SRendererInfo& info) {
-	static std::string selected = "";
+	static TAssetHandle<CMaterial> selected{};
 	if (ImGui::Begin("Materials")) {
 		ImGui::Text("Add Material");
 		ImGui::SameLine();
@@ -158,51 +160,46 @@ void renderMaterialUI(const SRendererInfo& info) {
 			// Get a name that isn't taken
 			int32 materialNumber = 0;
 			std::string testName;
-			bool contains = true;
-			while (contains) {
-
+			do {
 				testName = fmts("material {}", materialNumber);
-
-				contains = false;
-				for (const auto& material : CEngineLoader::getMaterials()) {
-					if (material.second->mName == testName) {
-						contains = true;
-						break;
-					}
-				}
-
 				materialNumber++;
-			}
+			} while (CEngineLoader::getMaterials().contains(testName));
 
 			TShared<CMaterial> material{};
 			material->mName = testName;
-			CEngineLoader::getMaterials().emplace(testName, material);
-			selected = testName;
+			selected = CEngineLoader::getMaterials().add(testName, material);
 		}
 
 		if (!CEngineLoader::getMaterials().empty()) {
 			ImGui::SameLine();
 			if (ImGui::SmallButton("-")) {
-				auto itr = std::prev(CEngineLoader::getMaterials().find(selected));
-				selected = itr == CEngineLoader::getMaterials().end() ? "" : itr->first;
-				CEngineLoader::getMaterials().erase(selected);
+				// Selects the material before the removed one
+				const auto names = CEngineLoader::getMaterials().getNames();
+				const auto itr = names.find(CEngineLoader::getMaterials().getName(selected));
+				const TAssetHandle<CMaterial> removed = selected;
+				selected = itr == names.end() || itr == names.begin() ? TAssetHandle<CMaterial>{} : std::prev(itr)->second;
+				CEngineLoader::getMaterials().remove(removed);
 			}
 		}
 
 		if (!CEngineLoader::getMaterials().empty()) {
-			CMaterial* material = CEngineLoader::getMaterials()[selected].get();
+			// Falls back to the first material if the selected one is gone
+			if (!CEngineLoader::getMaterials().resolve(selected)) {
+				selected = CEngineLoader::getMaterials().getNames().begin()->second;
+			}
+			CMaterial* material = CEngineLoader::getMaterials().resolve(selected);
 
 			if (material) {
 				if (ImGui::BeginCombo("Material", material->mName.c_str(), ImGuiComboFlags_HeightRegular)) {
-					for (auto itr = CEngineLoader::getMaterials().begin(); itr != CEngineLoader::getMaterials().end(); ++itr) {
-						const bool isSelected = selected == itr->first;
-						if (ImGui::Selectable(CEngineLoader::getMaterials()[itr->first]->mName.c_str(), isSelected))
-							selected = itr->first;
+					CEngineLoader::getMaterials().forEach([](const std::string&, const TAssetHandle<CMaterial> handle, const TShared<CMaterial>& other) {
+						const bool isSelected = selected == handle;
+						if (ImGui::Selectable(other->mName.c_str(), isSelected))
+							selected = handle;
 
 						// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
 						if (isSelected)
 							ImGui::SetItemDefaultFocus();
-					}
+					});
 
 					ImGui::EndCombo();
 				}
@@ -248,16 +245,16 @@ void renderSpriteUI(const SRendererInfo& info) {
 				if (ImGui::BeginTabItem(sprite->mName.c_str())) {
 					if (!CEngineLoader::getMaterials().empty()) {
 						if (ImGui::BeginCombo("Surface Material", sprite->getMaterial()->mName.c_str(), ImGuiComboFlags_HeightRegular)) {
-							for (const auto& material : CEngineLoader::getMaterials()) {
-								const bool isSelected = sprite->getMaterial() == material.second;
-								if (ImGui::Selectable(material.first.c_str(), isSelected)) {
-									//sprite->material = material.second;
+							CEngineLoader::getMaterials().forEach([&](const std::string& name, TAssetHandle<CMaterial>, const TShared<CMaterial>& material) {
+								const bool isSelected = sprite->getMaterial() == material;
+								if (ImGui::Selectable(name.c_str(), isSelected)) {
+									//sprite->material = material;
 								}
 
 								// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
 								if (isSelected)
 									ImGui::SetItemDefaultFocus();
-							}
+							});
 
 							ImGui::EndCombo();
 						}
@@ -277,6 +274,15 @@ void renderSpriteUI(const SRendererInfo& info) {
 
 void renderMeshUI(const SRendererInfo& info) {
 	if (ImGui::Begin("Meshes")) {
+		// Quantized meshes are a fraction of the size, but positions snap to 1/65535 of the mesh's bounds
+		static bool quantizeImports = true;
+		ImGui::Checkbox("Quantize Imported Vertices", &quantizeImports);
+
+		// Each level aims for half the triangles of the one before
+		static SMeshData::SLodSettings lodSettings;
+		ImGui::SliderInt("Imported Lods", reinterpret_cast<int*>(&lodSettings.mLodCount), 1, SStaticMesh::mMaxLods);
+		ImGui::SliderFloat("Max Lod Error", &lodSettings.mMaxError, 0.f, 1.f);
+
 		if (ImGui::Button("Import Mesh")) {
 
 			const static std::vector<std::pair<const char*, const char*>> filters = {
@@ -284,32 +290,38 @@ void renderMeshUI(const SRendererInfo& info) {
 			};
 
 			//TODO: file query shouldn't be in viewport
-			CEngineViewport::queryForFile(filters, [&](std::vector<std::string> inFiles) {
+			// The dialog calls back after this frame, so the choices are copied in
+			const SMeshData::EVertexEncoding encoding = quantizeImports ? SMeshData::EVertexEncoding::QUANTIZED : SMeshData::EVertexEncoding::LOSSLESS;
+
+			CEngineViewport::queryForFile(filters, [&, encoding, lods = lodSettings](std::vector<std::string> inFiles) {
 				for (const auto& file : inFiles) {
-					CThreading::runOnBackgroundThread([info, file] {
-						CEngineLoader::importMesh(info.renderer, file);
-					});
+					CThreading::runOnBackgroundThread([info, file, encoding, lods] {
+						CEngineLoader::importMesh(info.renderer, file, encoding, lods);
+					}, ETaskPriority::BACKGROUND);
 				}
 			});
 		}
-		for (const auto& [fst, snd] : CEngineLoader::getMeshes()) {
+		CEngineLoader::getMeshes().forEach([](const std::string&, TAssetHandle<SStaticMesh>, const TShared<SStaticMesh>& snd) {
+			// A streaming task fills in the surfaces of a mesh that isn't resident, so they can't be read until it is
+			if (!snd->isResident()) return;
+
 			if (ImGui::BeginTabBar("Mesh")) {
 				if (ImGui::BeginTabItem(snd->name.c_str())) {
 					for (auto& surface : snd->surfaces) {
 						ImGui::PushID(surface.name.c_str());
 						if (ImGui::CollapsingHeader(surface.name.c_str())) {
 							if (!CEngineLoader::getMaterials().empty()) {
-								if (ImGui::BeginCombo("Surface Material", surface.material->mName.c_str(), ImGuiComboFlags_HeightRegular)) {
-									for (const auto& material : CEngineLoader::getMaterials()) {
-										const bool isSelected = surface.material == material.second;
-										if (ImGui::Selectable(material.first.c_str(), isSelected)) {
-											surface.material = material.second.get();
+								if (ImGui::BeginCombo("Surface Material", surface.material ? surface.material->mName.c_str() : "None", ImGuiComboFlags_HeightRegular)) {
+									CEngineLoader::getMaterials().forEach([&](const std::string& name, TAssetHandle<CMaterial>, const TShared<CMaterial>& material) {
+										const bool isSelected = surface.material == material.get();
+										if (ImGui::Selectable(name.c_str(), isSelected)) {
+											surface.material = material.get();
 										}
 
 										// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
 										if (isSelected)
 											ImGui::SetItemDefaultFocus();
-									}
+									});
 
 									ImGui::EndCombo();
 								}
@@ -325,7 +337,7 @@ void renderMeshUI(const SRendererInfo& info) {
 				}
 			}
 			ImGui::EndTabBar();
-		}
+		});
 	}
 	ImGui::End();
 }
@@ -387,22 +399,33 @@ void CEngineUIPass::init(const TFrail<CRenderer> inRenderer) {
 	msgs("INIT UI PASS");
 }
 
-void CEngineUIPass::begin() {
+void CEngineUIPass::render(const SRendererInfo& info, const TFrail<CVRICommands>& cmd) {
+	const SRenderSnapshot& snapshot = *info.snapshot;
+
 	// Start the Dear ImGui frame
+	// The SDL backend would ask the window directly, which belongs to the game thread, so its input comes from the snapshot
+	{
+		ImGuiIO& io = ImGui::GetIO();
+		io.DisplaySize = ImVec2(static_cast<float>(snapshot.mViewportExtent.x), static_cast<float>(snapshot.mViewportExtent.y));
+		io.DisplayFramebufferScale = ImVec2(1.f, 1.f);
+		io.DeltaTime = snapshot.mDeltaTime > 0.f ? snapshot.mDeltaTime : 1.f / 60.f;
+		io.AddMousePosEvent(snapshot.mMousePosition.x, snapshot.mMousePosition.y);
+	}
 	ImGui_ImplVulkan_NewFrame();
-	ImGui_ImplSDL3_NewFrame();
 	ImGui::NewFrame();
-}
 
-void CEngineUIPass::render(const SRendererInfo& info, const TFrail<CVRICommands>& cmd) {
 	// Render Engine Settings
-	CEngineSettings::render();
+	CEngineSettings::render(snapshot.mSettings);
 
 	renderTextureUI(info);
 	renderMaterialUI(info);
 	renderSpriteUI(info);
 	renderMeshUI(info);
-	renderSceneUI(info);
+	// The game thread may be updating the scene at the same time
+	{
+		std::lock_guard lock(info.scene->mMutex);
+		renderSceneUI(info);
+	}
 	renderFontUI(info);
 
 	ImGui::Render();
@@ -1,20 +1,25 @@
 ﻿#include "renderer/passes/MeshPass.h"
 
 #include "engine/Engine.h"
+#include "engine/Viewport.h"
 #include "VRI/BindlessResources.h"
+#include "VRI/VRI.h"
 #include "renderer/EngineTextures.h"
 #include "renderer/VulkanRenderer.h"
 #include "rendercore/StaticMesh.h"
 #include "engine/EngineSettings.h"
 #include "scene/base/Scene.h"
 #include "renderer/object/StaticMeshObjectRenderer.h"
+#include "rendercore/RenderProxy.h"
+#include "basic/core/Threading.h"
 #include "tracy/Tracy.hpp"
 
 #define SETTINGS_CATEGORY "Rendering"
-ADD_TEXT(Meshes, "Meshes: ");
-ADD_TEXT(Drawcalls, "Draw Calls: ");
-ADD_TEXT(Vertices, "Vertices: ");
-ADD_TEXT(Triangles, "Triangles: ");
+ADD_RENDER_TEXT(Meshes, "Meshes: ");
+ADD_RENDER_TEXT(Drawcalls, "Draw Calls: ");
+ADD_RENDER_TEXT(Vertices, "Vertices: ");
+ADD_RENDER_TEXT(Triangles, "Triangles: ");
+ADD_COMMAND(float, LodErrorPixels, 1.f, 0.f, 16.f);
 #undef SETTINGS_CATEGORY
 
 //TODO: for now this is hard coded base pass, dont need anything else for now
@@ -88,6 +93,9 @@ void CMeshPass::destroy(){
 	transparentPipeline.destroy();
 	errorPipeline.destroy();
 	wireframePipeline.destroy();
+	for (auto& instanceBuffer : m_InstanceBuffers) {
+		instanceBuffer.destroy();
+	}
 }
 
 //TODO: probably faster with gpu
@@ -128,24 +136,21 @@ bool isVisible(const Matrix4f& inViewProj, const Matrix4f& inTransformMatrix, co
 	return true;
 }
 
-void renderChild(const SRendererInfo& info, CMeshPass* pass, const TFrail<CVRICommands>& cmd, SRenderStack3f& stack, THierarchy<CWorldObject>* inHierarchy, size_t& meshCount, size_t& drawCallCount, size_t& vertexCount) {
-	inHierarchy->getChildren().forEach([&](size_t index, TUnique<CWorldObject>& obj) {
-		stack.push(obj->getTransformMatrix());
-
-		if (const auto staticMesh = dynamic_cast<CStaticMeshObject*>(obj.get())) {
-			if (const auto rendererClass = dynamic_cast<IRenderableClass*>(staticMesh->getClass())) {
-
-
-				rendererClass->getRenderer()->render(info, pass, cmd, stack, staticMesh, drawCallCount, vertexCount);
+// How many pixels a world space distance of 1 covers at a depth of 1
+// The view only rotates and translates, so the length of the view projection's second row is the projection's y scale
+static float getPixelScale(const SRendererInfo& info, const Matrix4f& inViewProj) {
+	const float projectionScale = glm::length(Vector3f{inViewProj[0][1], inViewProj[1][1], inViewProj[2][1]});
+	return projectionScale * static_cast<float>(info.snapshot->mViewportExtent.y) * 0.5f;
+}
 
-				meshCount++;
-			}
-		}
+static uint32 selectLod(const SStaticMesh& inMesh, const Matrix4f& inViewProj, const Matrix4f& inTransform, const float inPixelScale, const float inMaxError) {
+	const float depth = (inViewProj * inTransform * Vector4f(inMesh.bounds.origin, 1.f)).w;
 
-		renderChild(info, pass, cmd, stack, obj.get(), meshCount, drawCallCount, vertexCount);
+	// Anything crossing the near plane is as close as it gets
+	if (depth <= 0.1f) return 0;
 
-		stack.pop();
-	});
+	const float scale = std::max({glm::length(Vector3f(inTransform[0])), glm::length(Vector3f(inTransform[1])), glm::length(Vector3f(inTransform[2]))});
+	return inMesh.selectLod(inMesh.bounds.sphereRadius * scale * inPixelScale / depth, inMaxError);
 }
 
 void CMeshPass::render(const SRendererInfo& info, const TFrail<CVRICommands>& cmd) {
@@ -155,8 +160,65 @@ void CMeshPass::render(const SRendererInfo& info, const TFrail<CVRICommands>& cm
 	size_t drawCallCount = 0;
 	size_t vertexCount = 0;
 
-	SRenderStack3f stack;
-	renderChild(info, this, cmd, stack, info.scene.get(), meshCount, drawCallCount, vertexCount);
+	const auto rendererClass = dynamic_cast<IRenderableClass*>(CStaticMeshObject::staticClass());
+	if (info.snapshot && !info.snapshot->mInstances.empty() && rendererClass && rendererClass->hasRenderer()) {
+		const SRenderSnapshot& snapshot = *info.snapshot;
+		const SStaticMeshProxies& proxies = snapshot.mStaticMeshes;
+
+		// One buffer per frame in flight (double buffered), so an upload never overwrites instances the gpu is still drawing
+		InstanceBuffer& frameInstanceBuffer = m_InstanceBuffers[CVRI::get()->getSwapchain()->m_Buffering.getFrameIndex() % m_InstanceBuffers.size()];
+
+		// Bake proxy transforms into their instances, so every proxy can share one instance buffer
+		// Each proxy's instances are grouped by lod, so every lod is drawn from a consecutive range
+		{
+			ZoneScopedN("Upload Instances");
+
+			const float pixelScale = getPixelScale(info, snapshot.mViewProjection);
+			const float maxLodError = LodErrorPixels.get(snapshot.mSettings);
+
+			m_WorldInstances.resize(snapshot.mInstances.size());
+			m_UngroupedInstances.resize(snapshot.mInstances.size());
+			m_InstanceLods.resize(snapshot.mInstances.size());
+			m_LodCounts.resize(proxies.getSize());
+			CThreading::parallelFor(0, proxies.getSize(), 64, [&](const size_t index) {
+				const SInstanceRange& range = proxies.mInstanceRanges[index];
+				const Matrix4f& transform = proxies.mTransforms[index];
+				const SStaticMesh* mesh = proxies.mMeshes[index];
+
+				// Lods are only filled in once the mesh is resident
+				const bool hasLods = mesh && mesh->isResident() && !mesh->lods.empty() && maxLodError > 0.f;
+
+				LodCounts& counts = m_LodCounts[index];
+				counts.fill(0);
+				for (uint32 instance = range.mFirst; instance < range.mFirst + range.mCount; ++instance) {
+					const Matrix4f worldTransform = transform * snapshot.mInstances[instance].Transform;
+					m_UngroupedInstances[instance].Transform = worldTransform;
+					m_InstanceLods[instance] = hasLods ? static_cast<uint8>(selectLod(*mesh, snapshot.mViewProjection, worldTransform, pixelScale, maxLodError)) : 0;
+					counts[m_InstanceLods[instance]]++;
+				}
+
+				// A counting sort, which keeps instances in the same order within each lod
+				LodCounts offsets;
+				uint32 offset = range.mFirst;
+				for (uint32 lod = 0; lod < SStaticMesh::mMaxLods; ++lod) {
+					offsets[lod] = offset;
+					offset += counts[lod];
+				}
+				for (uint32 instance = range.mFirst; instance < range.mFirst + range.mCount; ++instance) {
+					m_WorldInstances[offsets[m_InstanceLods[instance]]++] = m_UngroupedInstances[instance];
+				}
+			});
+
+			frameInstanceBuffer.push(m_WorldInstances.data(), m_WorldInstances.size() * sizeof(SInstance));
+		}
+
+		const auto renderer = static_cast<CStaticMeshObjectRenderer*>(rendererClass->getRenderer());
+		const VkBuffer instanceBuffer = frameInstanceBuffer.get()->buffer;
+		for (size_t index = 0; index < proxies.getSize(); ++index) {
+			renderer->render(info, this, cmd, proxies, index, instanceBuffer, m_LodCounts[index], drawCallCount, vertexCount);
+			meshCount++;
+		}
+	}
 
 	// Set number of meshes, drawcalls, vertices, and triangles
 	Meshes.setText(fmts("Meshes: {}", meshCount));
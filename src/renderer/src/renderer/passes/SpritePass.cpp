@@ -11,10 +11,10 @@
 #include "VRI/VRICommands.h"
 
 #define SETTINGS_CATEGORY "Rendering/Sprite Pass"
-ADD_TEXT(Sprites, "Sprites: ");
-ADD_TEXT(SpriteDrawcalls, "Draw Calls: ");
-ADD_TEXT(SpriteVertices, "Vertices: ");
-ADD_TEXT(SpriteTriangles, "Triangles: ");
+ADD_RENDER_TEXT(Sprites, "Sprites: ");
+ADD_RENDER_TEXT(SpriteDrawcalls, "Draw Calls: ");
+ADD_RENDER_TEXT(SpriteVertices, "Vertices: ");
+ADD_RENDER_TEXT(SpriteTriangles, "Triangles: ");
 #undef SETTINGS_CATEGORY
 
 void CSpritePass::init(TFrail<CRenderer> inRenderer) {